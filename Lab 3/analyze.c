@@ -0,0 +1,201 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "analyze.h"
+
+#define DEFAULT_MAX_KEYS (1 << 20)
+#define TOP_STRIDES 10
+
+static const char* type_names[] = { "read", "write", "ifetch" };
+
+analyze_t* analyze_create(const char* spec, int block_size) {
+    char* end;
+    long long window = strtoll(spec, &end, 10);
+    long long max_keys = DEFAULT_MAX_KEYS;
+    if (end == spec || window < 1) return NULL;
+    if (*end == ':') {
+        const char* p = end + 1;
+        max_keys = strtoll(p, &end, 10);
+        if (end == p || max_keys < 1 || max_keys > (1 << 29)) return NULL;
+    }
+    if (*end || block_size < 1 || (block_size & (block_size - 1))) return NULL;
+
+    analyze_t* a = (analyze_t*)calloc(1, sizeof(analyze_t));
+    while ((1 << a->line_bits) < block_size) a->line_bits++;
+    a->lines = reuse_create((int)max_keys);
+    a->pages = reuse_create((int)max_keys);
+    a->window = (counter_t)window;
+    return a;
+}
+
+/**
+ * @return the histogram bucket of reuse distance <distance>.
+ */
+static inline int bucket_of(long long distance) {
+    return distance ? 64 - __builtin_clzll((unsigned long long)distance) : 0;
+}
+
+/**
+ * Function to touch <key> in <t> and count the access in <hist>.
+ *
+ * @return whether this is the first access to <key> since access <since>.
+ */
+static int touch(reuse_tracker_t* t, addr_t key, counter_t* hist, counter_t* cold,
+                 counter_t* beyond, counter_t since) {
+    counter_t last_time;
+    long long distance = reuse_access(t, key, &last_time);
+    if (distance == REUSE_COLD) {
+        (*cold)++;
+        return 1;
+    }
+    if (distance == REUSE_BEYOND) {
+        (*beyond)++;
+        return 1;
+    }
+    hist[bucket_of(distance)]++;
+    return last_time < since;
+}
+
+/**
+ * Function to count an access of <table>'s type to <addr>.
+ */
+static void record_stride(stride_table_t* table, addr_t addr) {
+    if (!table->seen) {
+        table->seen = 1;
+        table->last = addr;
+        return;
+    }
+    long long stride = (long long)(addr - table->last);
+    table->last = addr;
+    table->total++;
+
+    unsigned int mask = ANALYZE_STRIDES - 1;
+    unsigned int slot = (unsigned int)(((unsigned long long)stride * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+    while (table->counts[slot] && table->strides[slot] != stride) {
+        slot = (slot + 1) & mask;
+    }
+    if (table->counts[slot]) {
+        table->counts[slot]++;
+    } else if (table->used < ANALYZE_STRIDES / 2) {
+        // Keep the table at most half full so probes stay short
+        table->strides[slot] = stride;
+        table->counts[slot] = 1;
+        table->used++;
+    } else {
+        table->other++;
+    }
+}
+
+/**
+ * Function to record the working set of the current window and start the next one.
+ */
+static void finish_window(analyze_t* a) {
+    if (a->num_windows == a->max_windows) {
+        a->max_windows = a->max_windows ? a->max_windows * 2 : 64;
+        a->ws_lines = (counter_t*)realloc(a->ws_lines, sizeof(counter_t) * a->max_windows);
+        a->ws_pages = (counter_t*)realloc(a->ws_pages, sizeof(counter_t) * a->max_windows);
+    }
+    a->ws_lines[a->num_windows] = a->window_lines;
+    a->ws_pages[a->num_windows] = a->window_pages;
+    a->num_windows++;
+    a->window_start = a->accesses;
+    a->window_lines = 0;
+    a->window_pages = 0;
+}
+
+counter_t analyze_run(analyze_t* a, trace_t* trace) {
+    const trace_record_t* batch;
+    size_t n;
+    counter_t total = 0;
+    while ((n = trace_next_batch(trace, &batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            addr_t addr = batch[i].addr;
+            int type = trace_record_type(&batch[i]);
+            // Anything that is not a write or an instruction fetch is counted as a read
+            if (type != MEMWRITE && type != IFETCH) type = MEMREAD;
+
+            a->window_lines += touch(a->lines, addr >> a->line_bits, a->line_hist,
+                                     &a->line_cold, &a->line_beyond, a->window_start);
+            a->window_pages += touch(a->pages, addr / ANALYZE_PAGE_SIZE, a->page_hist,
+                                     &a->page_cold, &a->page_beyond, a->window_start);
+            record_stride(&a->strides[type], addr);
+            if (++a->accesses - a->window_start == a->window) finish_window(a);
+        }
+        total += n;
+    }
+    if (a->accesses > a->window_start) finish_window(a);
+    return total;
+}
+
+/**
+ * Function to print the most common strides in <table>.
+ */
+static void print_strides(const stride_table_t* table, const char* name, FILE* out) {
+    if (!table->total) return;
+    int top[TOP_STRIDES];
+    int num_top = 0;
+    for (int i = 0; i < ANALYZE_STRIDES; i++) {
+        if (!table->counts[i]) continue;
+        // Insertion into the sorted top list, most common first
+        int at = num_top < TOP_STRIDES ? num_top++ : TOP_STRIDES;
+        while (at > 0 && table->counts[top[at - 1]] < table->counts[i]) {
+            if (at < TOP_STRIDES) top[at] = top[at - 1];
+            at--;
+        }
+        if (at < TOP_STRIDES) top[at] = i;
+    }
+
+    counter_t listed = 0;
+    for (int i = 0; i < num_top; i++) {
+        counter_t count = table->counts[top[i]];
+        listed += count;
+        fprintf(out, "%s, %lld, %llu, %.6f\n", name, table->strides[top[i]], count,
+                (double)count / table->total);
+    }
+    if (table->total > listed) {
+        counter_t rest = table->total - listed;
+        fprintf(out, "%s, other, %llu, %.6f\n", name, rest, (double)rest / table->total);
+    }
+}
+
+void analyze_print(const analyze_t* a, FILE* out) {
+    int last = 0;
+    for (int i = 0; i < ANALYZE_BUCKETS; i++) {
+        if (a->line_hist[i] || a->page_hist[i]) last = i;
+    }
+    fprintf(out, "distance, line_reuses, page_reuses\n");
+    for (int i = 0; i <= last; i++) {
+        if (i < 2) {
+            fprintf(out, "%d", i);
+        } else {
+            fprintf(out, "%llu-%llu", 1ULL << (i - 1), (1ULL << i) - 1);
+        }
+        fprintf(out, ", %llu, %llu\n", a->line_hist[i], a->page_hist[i]);
+    }
+    fprintf(out, "cold, %llu, %llu\n", a->line_cold, a->page_cold);
+    fprintf(out, "beyond, %llu, %llu\n", a->line_beyond, a->page_beyond);
+
+    fprintf(out, "window, start, lines, pages\n");
+    for (size_t i = 0; i < a->num_windows; i++) {
+        fprintf(out, "%zu, %llu, %llu, %llu\n", i, (counter_t)i * a->window, a->ws_lines[i],
+                a->ws_pages[i]);
+    }
+
+    fprintf(out, "type, stride, count, share\n");
+    for (int type = MEMREAD; type <= IFETCH; type++) {
+        print_strides(&a->strides[type], type_names[type], out);
+    }
+}
+
+void analyze_free(analyze_t* a) {
+    if (!a) return;
+    reuse_free(a->lines);
+    reuse_free(a->pages);
+    free(a->ws_lines);
+    free(a->ws_pages);
+    free(a);
+}
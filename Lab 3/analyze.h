@@ -0,0 +1,87 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __ANALYZE_H
+#define __ANALYZE_H
+
+#include <stdio.h>
+#include "cachesim.h"
+#include "reuse.h"
+
+/**
+ * Trace analytics, independent of any cache configuration:
+ *  - reuse distances of every access at line and page granularity, as log2 histograms
+ *  - the working set, in distinct lines and pages, of every window of <window> accesses
+ *  - the distribution of byte strides between consecutive accesses of each type
+ *
+ * Memory does not grow with the trace except for one record per window. The reuse
+ * trackers hold at most <max keys> lines and pages each, plus a fixed-size filter of
+ * the keys they dropped; see reuse.h. Distances and beyond counts are exact, but cold
+ * counts are approximate once the trace has many more distinct lines or pages than
+ * that. Working sets are exact as long as no window touches more than <max keys> lines. The stride tables hold
+ * a fixed number of distinct strides per type and count the rest as "other".
+ */
+
+#define ANALYZE_PAGE_SIZE 4096
+#define ANALYZE_BUCKETS 64		// Histogram buckets: 0, then [2^(k-1), 2^k) for bucket k
+#define ANALYZE_STRIDES 4096	// Stride table size per access type
+
+typedef struct stride_table_t {
+	long long strides[ANALYZE_STRIDES];		// Stride of each entry
+	counter_t counts[ANALYZE_STRIDES];		// Accesses with that stride, 0 if the entry is empty
+	size_t used;							// Entries in use
+	counter_t other;						// Accesses whose stride did not fit in the table
+	counter_t total;						// Accesses with a stride
+	addr_t last;							// Address of the last access of this type
+	int seen;								// Whether there has been an access of this type
+} stride_table_t;
+
+typedef struct analyze_t {
+	int line_bits;							// log2 of the line size
+	reuse_tracker_t* lines;					// Reuse of line addresses
+	reuse_tracker_t* pages;					// Reuse of page addresses
+	counter_t line_hist[ANALYZE_BUCKETS];	// Line reuse distance histogram
+	counter_t page_hist[ANALYZE_BUCKETS];	// Page reuse distance histogram
+	counter_t line_cold, line_beyond;		// Line accesses without a distance
+	counter_t page_cold, page_beyond;		// Page accesses without a distance
+	counter_t window;						// Accesses per working set window
+	counter_t window_start;					// First access of the current window
+	counter_t window_lines;					// Distinct lines in the current window
+	counter_t window_pages;					// Distinct pages in the current window
+	size_t num_windows;						// Windows finished
+	size_t max_windows;						// Windows allocated
+	counter_t* ws_lines;					// Distinct lines of each finished window
+	counter_t* ws_pages;					// Distinct pages of each finished window
+	stride_table_t strides[3];				// Stride tables, indexed by access type
+	counter_t accesses;						// Accesses analyzed
+} analyze_t;
+
+/**
+ * Function to create an analyzer from <spec>, "<window>[:<max keys>]", for lines of
+ * <block_size> bytes. <max keys> defaults to 1M.
+ *
+ * @return the dynamically allocated analyzer, or NULL if <spec> or <block_size> is
+ *      invalid.
+ */
+analyze_t* analyze_create(const char* spec, int block_size);
+
+/**
+ * Function to analyze every record of <trace>.
+ *
+ * @return the number of records analyzed
+ */
+counter_t analyze_run(analyze_t* a, trace_t* trace);
+
+/**
+ * Function to print the reuse distance histograms, the working set of every window
+ * and the most common strides of each access type, each as a CSV header and lines.
+ */
+void analyze_print(const analyze_t* a, FILE* out);
+
+/**
+ * Function to free <a>.
+ */
+void analyze_free(analyze_t* a);
+
+#endif
@@ -0,0 +1,298 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+/**
+ * Throughput benchmark for cachesim. It runs a cachesim binary with -t on every trace
+ * for every cache geometry of a grid, several times each, and prints one CSV line per
+ * trace and geometry: the best simulation time, accesses per second, ns per access
+ * and the peak RSS of the process. Each run is a separate process, so the RSS is that
+ * of the one geometry.
+ *
+ * With -c, the results are compared with an earlier run's CSV, and the exit status is
+ * 1 if any geometry got slower per access by more than the tolerance. Traces made by
+ * tracegen, in the binary format, keep decoding out of the measurement.
+ *
+ * Build: gcc -std=gnu99 -O2 cachebench.c -o cachebench
+ * Usage: ./cachebench [-n runs] [-g blocks:sizes:ways] [-r policy] [-j threads]
+ *                     [-c baseline[:tolerance%]] <cachesim> <trace> [<trace> ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define DEFAULT_GRID "64:4096,32768,262144,2097152:1,8,256"
+#define MAX_VALUES 32
+#define MAX_BASELINE 4096
+
+typedef struct run_result_t {
+	unsigned long long accesses;
+	double seconds;		// Simulation time reported by cachesim -t
+	long peak_rss_kb;
+} run_result_t;
+
+typedef struct baseline_t {
+	char trace[256];
+	long block, size, ways;
+	double ns_per_access;
+} baseline_t;
+
+/**
+ * Parses a comma-separated list of positive numbers.
+ *
+ * @return the number of values, or -1 if the list is invalid.
+ */
+static int parse_list(const char* s, size_t len, long* values) {
+    int n = 0;
+    const char* end = s + len;
+    while (s < end) {
+        char* next;
+        long v = strtol(s, &next, 10);
+        if (next == s || next > end || v <= 0 || n == MAX_VALUES) return -1;
+        values[n++] = v;
+        s = next;
+        if (s < end && *s++ != ',') return -1;
+    }
+    return n;
+}
+
+/**
+ * Runs <argv> with its standard output discarded and its standard error captured.
+ *
+ * @return 0 on success, -1 if it could not be run or did not report its throughput.
+ */
+static int run_cachesim(char** argv, run_result_t* result) {
+    int err[2];
+    if (pipe(err) < 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(err[1], STDERR_FILENO);
+        close(err[0]);
+        execv(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    close(err[1]);
+
+    char buf[4096];
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(err[0], buf + len, sizeof(buf) - 1 - len)) > 0) {
+        len += n;
+        if (len == sizeof(buf) - 1) {
+            // Only the last line matters: keep the partial one at the end, if it fits
+            size_t keep = 0;
+            while (keep < len && buf[len - 1 - keep] != '\n') keep++;
+            if (keep == len) keep = 0;
+            memmove(buf, buf + len - keep, keep);
+            len = keep;
+        }
+    }
+    buf[len] = '\0';
+    close(err[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) return -1;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fputs(buf, stderr);
+        return -1;
+    }
+
+    // "<format> trace: <n> accesses in <seconds> s (...)"
+    const char* line = strstr(buf, " trace: ");
+    if (!line || sscanf(line, " trace: %llu accesses in %lf s", &result->accesses,
+                        &result->seconds) != 2) {
+        return -1;
+    }
+    result->peak_rss_kb = usage.ru_maxrss;
+    return 0;
+}
+
+/**
+ * Loads the results of an earlier run.
+ *
+ * @return the number of results, or -1 if the file could not be read.
+ */
+static int load_baseline(const char* filename, baseline_t* baseline) {
+    FILE* f = fopen(filename, "r");
+    if (!f) return -1;
+    char line[1024];
+    int n = 0;
+    while (n < MAX_BASELINE && fgets(line, sizeof(line), f)) {
+        baseline_t* b = &baseline[n];
+        if (sscanf(line, "%255[^,], %ld, %ld, %ld, %*u, %*f, %*f, %lf", b->trace, &b->block,
+                   &b->size, &b->ways, &b->ns_per_access) == 5) {
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-n runs] [-g blocks:sizes:ways] [-r policy] [-j threads]"
+                    " [-c baseline[:tolerance%%]] <cachesim> <trace> [<trace> ...]\n"
+                    "  -n  runs per trace and geometry; the fastest counts (default 3)\n"
+                    "  -g  geometry grid, comma-separated lists (default %s)\n"
+                    "  -r  replacement policy passed to cachesim\n"
+                    "  -j  thread count passed to cachesim\n"
+                    "  -c  compare with an earlier run's output and fail if ns per access\n"
+                    "      grew by more than <tolerance> percent (default 10)\n",
+            prog, DEFAULT_GRID);
+}
+
+int main(int argc, char** argv) {
+    const char* prog = argv[0];
+    int runs = 3;
+    const char* grid = DEFAULT_GRID;
+    const char* policy = NULL;
+    const char* threads = NULL;
+    const char* baseline_spec = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:g:r:j:c:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            runs = atoi(optarg);
+            break;
+        case 'g':
+            grid = optarg;
+            break;
+        case 'r':
+            policy = optarg;
+            break;
+        case 'j':
+            threads = optarg;
+            break;
+        case 'c':
+            baseline_spec = optarg;
+            break;
+        default:
+            print_usage(prog);
+            return 1;
+        }
+    }
+    if (argc - optind < 2 || runs < 1) {
+        print_usage(prog);
+        return 1;
+    }
+
+    long blocks[MAX_VALUES], sizes[MAX_VALUES], ways[MAX_VALUES];
+    const char* sep1 = strchr(grid, ':');
+    const char* sep2 = sep1 ? strchr(sep1 + 1, ':') : NULL;
+    int num_blocks = sep2 ? parse_list(grid, sep1 - grid, blocks) : -1;
+    int num_sizes = sep2 ? parse_list(sep1 + 1, sep2 - sep1 - 1, sizes) : -1;
+    int num_ways = sep2 ? parse_list(sep2 + 1, strlen(sep2 + 1), ways) : -1;
+    if (num_blocks < 1 || num_sizes < 1 || num_ways < 1) {
+        fprintf(stderr, "Invalid geometry grid: %s\n", grid);
+        return 1;
+    }
+
+    baseline_t* baseline = NULL;
+    int num_baseline = 0;
+    double tolerance = 10.0;
+    if (baseline_spec) {
+        char filename[1024];
+        snprintf(filename, sizeof(filename), "%s", baseline_spec);
+        char* colon = strrchr(filename, ':');
+        if (colon) {
+            tolerance = atof(colon + 1);
+            *colon = '\0';
+        }
+        baseline = (baseline_t*)malloc(sizeof(baseline_t) * MAX_BASELINE);
+        num_baseline = load_baseline(filename, baseline);
+        if (num_baseline < 0) {
+            perror("Unable to read baseline");
+            free(baseline);
+            return 1;
+        }
+    }
+
+    printf("trace, block, size, ways, accesses, seconds, maccesses_per_s, ns_per_access,"
+           " peak_rss_kb%s\n", baseline ? ", baseline_ns_per_access, change" : "");
+    int status = 0;
+    for (int t = optind + 1; t < argc; t++) {
+        for (int b = 0; b < num_blocks; b++) {
+            for (int s = 0; s < num_sizes; s++) {
+                for (int w = 0; w < num_ways; w++) {
+                    // Skip geometries with fewer blocks than ways
+                    if ((long long)blocks[b] * ways[w] > sizes[s]) continue;
+
+                    char block_arg[32], size_arg[32], ways_arg[32];
+                    snprintf(block_arg, sizeof(block_arg), "%ld", blocks[b]);
+                    snprintf(size_arg, sizeof(size_arg), "%ld", sizes[s]);
+                    snprintf(ways_arg, sizeof(ways_arg), "%ld", ways[w]);
+                    char* args[16];
+                    int n = 0;
+                    args[n++] = argv[optind];
+                    args[n++] = "-t";
+                    if (policy) {
+                        args[n++] = "-r";
+                        args[n++] = (char*)policy;
+                    }
+                    if (threads) {
+                        args[n++] = "-j";
+                        args[n++] = (char*)threads;
+                    }
+                    args[n++] = argv[t];
+                    args[n++] = block_arg;
+                    args[n++] = size_arg;
+                    args[n++] = ways_arg;
+                    args[n] = NULL;
+
+                    run_result_t best;
+                    memset(&best, 0, sizeof(best));
+                    for (int r = 0; r < runs; r++) {
+                        run_result_t result;
+                        if (run_cachesim(args, &result) < 0) {
+                            fprintf(stderr, "Failed to run %s on %s %s %s %s\n", args[0], argv[t],
+                                    block_arg, size_arg, ways_arg);
+                            free(baseline);
+                            return 1;
+                        }
+                        if (r == 0 || result.seconds < best.seconds) best.seconds = result.seconds;
+                        if (result.peak_rss_kb > best.peak_rss_kb) best.peak_rss_kb = result.peak_rss_kb;
+                        best.accesses = result.accesses;
+                    }
+
+                    double ns = best.accesses ? best.seconds * 1e9 / best.accesses : 0.0;
+                    double rate = best.seconds > 0 ? best.accesses / best.seconds / 1e6 : 0.0;
+                    printf("%s, %ld, %ld, %ld, %llu, %.3f, %.2f, %.2f, %ld", argv[t], blocks[b],
+                           sizes[s], ways[w], best.accesses, best.seconds, rate, ns,
+                           best.peak_rss_kb);
+                    for (int i = 0; i < num_baseline; i++) {
+                        baseline_t* base = &baseline[i];
+                        if (strcmp(base->trace, argv[t]) != 0 || base->block != blocks[b]
+                            || base->size != sizes[s] || base->ways != ways[w]) {
+                            continue;
+                        }
+                        double change = base->ns_per_access > 0
+                                        ? (ns / base->ns_per_access - 1) * 100 : 0.0;
+                        printf(", %.2f, %+.1f%%", base->ns_per_access, change);
+                        if (change > tolerance) {
+                            fprintf(stderr, "%s %ld:%ld:%ld: %.2f ns/access, was %.2f\n",
+                                    argv[t], blocks[b], sizes[s], ways[w], ns, base->ns_per_access);
+                            status = 1;
+                        }
+                        break;
+                    }
+                    printf("\n");
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+    free(baseline);
+    return status;
+}
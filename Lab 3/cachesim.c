@@ -2,11 +2,40 @@
  * @author ECE 3058 TAs
  */
 
+/**
+ * Cache simulator. Run it without arguments for its modes and options.
+ *
+ * Build: make cachesim, or
+ *        gcc -std=gnu99 -O2 -pthread cachesim.c lrustack.c trace.c mrc.c sweep.c
+ *            replacement.c hierarchy.c prefetch.c writepath.c timing.c multicore.c
+ *            classify.c pcprofile.c interval.c sample.c reuse.c analyze.c linemap.c
+ *            -o cachesim -lz -lm
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "cachesim.h"
+#include "trace.h"
+#include "mrc.h"
+#include "sweep.h"
+#include "hierarchy.h"
+#include "timing.h"
+#include "prefetch.h"
+#include "writepath.h"
+#include "multicore.h"
+#include "classify.h"
+#include "pcprofile.h"
+#include "interval.h"
+#include "sample.h"
+#include "analyze.h"
 
 // Statistics you will need to keep track. DO NOT CHANGE THESE.
 counter_t accesses = 0;     // Total number of cache accesses
@@ -31,27 +60,9 @@ int simple_log_2(int x) {
     return val;
 }
 
-//  Here are some global variables you may find useful to get you started.
-//      Feel free to add/change anyting here.
-cache_set_t* cache;     // Data structure for the cache
-int block_size;         // Block size
-int cache_size;         // Cache size
-int ways;               // Ways
-int num_sets;           // Number of sets
-int num_offset_bits;    // Number of offset bits
-int num_index_bits;     // Number of index bits.
-int num_blocks;
-
 /**
- * Function to intialize your cache simulator with the given cache parameters.
- * Note that we will only input valid parameters and all the inputs will always
- * be a power of 2.
- *
- * @param _block_size is the block size in bytes
- * @param _cache_size is the cache size in bytes
- * @param _ways is the associativity
+ * Function to compute 2^num.
  */
-
 int power_of_two(int num){
   int expo=1;
   for(int i=0; i<num; i++){
@@ -59,141 +70,930 @@ int power_of_two(int num){
   }
   return expo;
 }
-void cachesim_init(int _block_size, int _cache_size, int _ways) {
-    // Set cache parameters to global variables
-    block_size = _block_size;
-    cache_size = _cache_size;
-    ways = _ways;
-    num_blocks= cache_size/block_size;
-    num_sets=num_blocks/ways;
-    num_index_bits=simple_log_2(num_sets);
-    num_offset_bits=simple_log_2(block_size);
-    cache=(cache_set_t*)malloc(sizeof(cache_set_t)*num_sets);
 
+static void select_kernel(cache_t* c);
+
+/**
+ * Function to create a cache with the given cache parameters. Note that we will
+ * only input valid parameters and all the inputs will always be a power of 2.
+ *
+ * @param block_size is the block size in bytes
+ * @param cache_size is the cache size in bytes
+ * @param ways is the associativity
+ * @param policy is the replacement policy, NULL for LRU
+ * @return the dynamically allocated cache, with all blocks invalid.
+ */
+cache_t* cache_create(int block_size, int cache_size, int ways, const repl_policy_t* policy) {
+    cache_t* c=(cache_t*)calloc(1, sizeof(cache_t));
+    c->block_size = block_size;
+    c->cache_size = cache_size;
+    c->ways = ways;
+    c->num_blocks= cache_size/block_size;
+    c->num_sets=c->num_blocks/ways;
+    c->num_index_bits=simple_log_2(c->num_sets);
+    c->num_offset_bits=simple_log_2(block_size);
+    c->sets=(cache_set_t*)malloc(sizeof(cache_set_t)*c->num_sets);
+    c->repl=repl_create(policy ? policy : repl_find("lru"), c->num_sets, ways);
+
+    // One allocation for all tags and one for all valid/dirty bits, so neighbouring
+    // sets sit next to each other in memory. Every block starts out invalid.
+    c->tag_stride=(ways+TAG_LANES-1)/TAG_LANES*TAG_LANES;
+    c->bit_words=(ways+WAYS_PER_WORD-1)/WAYS_PER_WORD;
+    void* tag_store=NULL;
+    if (posix_memalign(&tag_store, 2*sizeof(unsigned int)*TAG_LANES,
+                       2*sizeof(unsigned int)*c->tag_stride*c->num_sets)!=0){
+      repl_free(c->repl);
+      free(c->sets);
+      free(c);
+      return NULL;
+    }
+    c->tag_store=(unsigned int*)tag_store;
+    memset(c->tag_store, 0, 2*sizeof(unsigned int)*c->tag_stride*c->num_sets);
+    c->bit_store=(unsigned long long*)calloc(2*(size_t)c->bit_words*c->num_sets,
+                                             sizeof(unsigned long long));
+
+    // Highly associative sets get a hash index from tag to way
+    if (ways>HASHED_WAYS_THRESHOLD){
+      c->indexes=(line_map_t*)malloc(sizeof(line_map_t)*c->num_sets);
+      for (int i=0; i<c->num_sets; i++){
+        line_map_init(&(c->indexes[i]), ways, 1);
+      }
+    }
+
+    for (int i=0; i<c->num_sets; i++){
+      cache_set_t* set=&(c->sets[i]);
+      set->size=ways;
+      set->repl_state=repl_set_state(c->repl, i);
+      set->tags=c->tag_store+(size_t)2*i*c->tag_stride;
+      set->tags_high=set->tags+c->tag_stride;
+      set->valid=c->bit_store+(size_t)2*i*c->bit_words;
+      set->dirty=set->valid+c->bit_words;
+      set->num_valid=0;
+      set->index=c->indexes ? &(c->indexes[i]) : NULL;
+    }
+    select_kernel(c);
+    return c;
+}
+
+/**
+ * Function to create a cache from <config>.
+ *
+ * @return the dynamically allocated cache, with all blocks invalid.
+ */
+cache_t* cache_create_from_config(const cache_config_t* config) {
+    return cache_create(config->block_size, config->cache_size, config->ways, config->policy);
+}
+
+/**
+ * Function to split an address into the tag and the set index. Tags keep every bit
+ * above the index, so no two addresses share a tag and an index unless they are in
+ * the same block.
+ */
+static inline void split_address(const cache_t* c, addr_t physical_addr, addr_t* tag, int* index) {
+    addr_t line_addr=physical_addr>>c->num_offset_bits;
+    *tag=line_addr>>c->num_index_bits;
+    *index=(int)(line_addr&(addr_t)(c->num_sets-1));
+}
+
+/**
+ * Function to compare <tag> against a group of tags.
+ *
+ * @param tags is the first tag half of the group; it must be aligned to TAG_LANES ints.
+ * @param lanes is the number of tags to compare, a multiple of TAG_LANES no larger
+ *      than WAYS_PER_WORD.
+ * @param tag is the tag half to look for.
+ * @return a bitmask with bit i set if tags[i] == tag.
+ */
+static inline unsigned long long match_tags(const unsigned int* tags, int lanes, unsigned int tag) {
+    unsigned long long mask=0;
+#if defined(__AVX2__)
+    __m256i key=_mm256_set1_epi32((int)tag);
+    for (int i=0; i<lanes; i+=8){
+      __m256i eq=_mm256_cmpeq_epi32(_mm256_load_si256((const __m256i*)(tags+i)), key);
+      mask|=(unsigned long long)(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(eq))<<i;
+    }
+#elif defined(__SSE2__)
+    __m128i key=_mm_set1_epi32((int)tag);
+    for (int i=0; i<lanes; i+=4){
+      __m128i eq=_mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(tags+i)), key);
+      mask|=(unsigned long long)(unsigned int)_mm_movemask_ps(_mm_castsi128_ps(eq))<<i;
+    }
+#else
+    for (int i=0; i<lanes; i++){
+      mask|=(unsigned long long)(tags[i]==tag)<<i;
+    }
+#endif
+    return mask;
+}
+
+/**
+ * Function to get the tag of <way> of <set>.
+ */
+static inline addr_t block_tag(const cache_set_t* set, int way) {
+    return (addr_t)set->tags_high[way]<<32|set->tags[way];
+}
+
+/**
+ * Function to pick, out of the ways in <candidates> whose low tag half matches, the
+ * one whose high half does too.
+ *
+ * @return the way holding the tag with high half <high>, or -1 if none does.
+ */
+static inline int match_high(const unsigned int* tags_high, unsigned long long candidates,
+                             unsigned int high) {
+    while (candidates){
+      int way=__builtin_ctzll(candidates);
+      if (tags_high[way]==high){
+        return way;
+      }
+      candidates&=candidates-1;
+    }
+    return -1;
+}
+
+/**
+ * Function to add <way>, which must already hold its tag, to the hash index of <set>.
+ */
+static inline void index_insert(cache_set_t* set, int way) {
+    line_map_insert(set->index, block_tag(set, way), way);
+}
 
+/**
+ * Function to remove <way> from the hash index of <set>.
+ */
+static inline void index_remove(cache_set_t* set, int way) {
+    line_map_remove(set->index, block_tag(set, way), NULL);
+}
 
-    for (int i=0; i<num_sets; i++){
-      cache[i].size=ways;
-      cache[i].stack=init_lru_stack(ways);
-      cache[i].blocks=(cache_block_t*)malloc(sizeof(cache_block_t)*cache[i].size);
-      for (int j=0; j< ways; j++){
-        (cache->blocks[j]).tag=0;
-        (cache->blocks[j]).valid=1;
-        (cache->blocks[j]).dirty=0;
+/**
+ * Function to find the block of <set> that holds <tag>.
+ *
+ * @return the way holding <tag>, or -1 if it is not in the set.
+ */
+static inline int cache_set_find(const cache_set_t* set, addr_t tag) {
+    if (set->index){
+      return (int)line_map_find(set->index, tag);
+    }
+    int padded=(set->size+TAG_LANES-1)/TAG_LANES*TAG_LANES;
+    for (int base=0, w=0; base<padded; base+=WAYS_PER_WORD, w++){
+      int lanes=padded-base<WAYS_PER_WORD ? padded-base : WAYS_PER_WORD;
+      unsigned long long hit=match_tags(set->tags+base, lanes, (unsigned int)tag)&set->valid[w];
+      int way=match_high(set->tags_high+base, hit, (unsigned int)(tag>>32));
+      if (way>=0){
+        return base+way;
       }
     }
+    return -1;
+}
+
+/**
+ * Function to find the lowest numbered invalid block of <set>.
+ *
+ * @return the way of an invalid block, or -1 if the set is full.
+ */
+static inline int cache_set_find_invalid(const cache_set_t* set) {
+    if (set->num_valid==set->size){
+      return -1;
+    }
+    for (int base=0, w=0; base<set->size; base+=WAYS_PER_WORD, w++){
+      unsigned long long ways_here=set->size-base<WAYS_PER_WORD
+                                   ? (1ULL<<(set->size-base))-1 : ~0ULL;
+      unsigned long long free=~set->valid[w]&ways_here;
+      if (free){
+        return base+__builtin_ctzll(free);
+      }
+    }
+    return -1;
+}
+
+/**
+ * Function to get the address of the first byte of the block with <tag> in set <index>.
+ */
+static inline addr_t block_address(const cache_t* c, addr_t tag, int index) {
+    addr_t line_addr=(tag<<c->num_index_bits)|(addr_t)index;
+    return line_addr<<c->num_offset_bits;
+}
+
+/**
+ * Function to record a hit on <way> of set <index>.
+ */
+static inline void cache_set_hit(cache_t* c, int index, int way, int access_type) {
+    cache_set_t* set=&(c->sets[index]);
+    c->repl->policy->on_hit(c->repl, set->repl_state, index, way);
+    if (access_type==MEMWRITE){
+      set->dirty[way/WAYS_PER_WORD]|=1ULL<<(way%WAYS_PER_WORD);
+    }
+}
 
+/**
+ * Function to bring the block with <tag> into set <index>, which must not hold it yet.
+ * An invalid block is used if there is one, otherwise the policy's victim is evicted.
+ *
+ * @param dirty is 1 if the new block is dirty.
+ * @param evicted_tag is set to the tag of the evicted block, if any.
+ * @return EVICT_NONE, EVICT_CLEAN or EVICT_DIRTY.
+ */
+static inline int cache_set_fill(cache_t* c, int index, addr_t tag, int dirty,
+                                 addr_t* evicted_tag) {
+    cache_set_t* set=&(c->sets[index]);
+    int result=EVICT_NONE;
+    int way=cache_set_find_invalid(set);
+    if (way<0){
+      way=c->repl->policy->victim(c->repl, set->repl_state, index);
+      if (set->index){
+        index_remove(set, way);
+      }
+      *evicted_tag=block_tag(set, way);
+      result=EVICT_CLEAN;
+    }
+    else{
+      set->num_valid+=1;
+    }
+    unsigned long long* dirty_word=&(set->dirty[way/WAYS_PER_WORD]);
+    unsigned long long bit=1ULL<<(way%WAYS_PER_WORD);
+    if (*dirty_word&bit){
+      result=EVICT_DIRTY;
+    }
+    if (dirty){
+      *dirty_word|=bit;
+    }
+    else{
+      *dirty_word&=~bit;
+    }
+    set->valid[way/WAYS_PER_WORD]|=bit;
+    set->tags[way]=(unsigned int)tag;
+    set->tags_high[way]=(unsigned int)(tag>>32);
+    if (set->index){
+      index_insert(set, way);
+    }
+    c->repl->policy->on_fill(c->repl, set->repl_state, index, way);
+    return result;
+}
 
-    ////////////////////////////////////////////////////////////////////
-    //  TODO: Write the rest of the code needed to initialize your cache
-    //  simulator. Some of the things you may want to do are:
-    //      - Calculate any values you need such as number of index bits.
-    //      - Allocate any data structures you need.
-    ////////////////////////////////////////////////////////////////////
+/**
+ * Function to perform an access to a single cache set. Sets never interact (unless the
+ * replacement policy duels sets), so this touches nothing but set <index> and is safe
+ * to call concurrently on different sets.
+ *
+ * @param c is the cache.
+ * @param index is the set the address maps to.
+ * @param tag is the tag of the address.
+ * @param access_type is the type of access (MEMREAD, MEMWRITE or IFETCH).
+ * @return ACCESS_HIT, ACCESS_MISS or ACCESS_WRITEBACK.
+ */
+static inline int cache_set_access(cache_t* c, int index, addr_t tag, int access_type) {
+    int way=cache_set_find(&(c->sets[index]), tag);
+    if (way>=0){
+      cache_set_hit(c, index, way, access_type);
+      return ACCESS_HIT;
+    }
 
-    ////////////////////////////////////////////////////////////////////
-    //  End of your code
-    ////////////////////////////////////////////////////////////////////
+    addr_t evicted_tag;
+    if (cache_set_fill(c, index, tag, access_type==MEMWRITE, &evicted_tag)==EVICT_DIRTY){
+      return ACCESS_WRITEBACK;
+    }
+    return ACCESS_MISS;
 }
 
 /**
- * Function to perform a SINGLE memory access to your cache. In this function,
- * you will need to update the required statistics (accesses, hits, misses, writebacks)
- * and update your cache data structure with any changes necessary.
+ * Function to perform a SINGLE memory access to <c>, updating its statistics
+ * (accesses, hits, misses, writebacks).
  *
+ * @param c is the cache to access.
  * @param physical_addr is the address to use for the memory access.
  * @param access_type is the type of access - 0 (data read), 1 (data write) or
  *      2 (instruction read). We have provided macros (MEMREAD, MEMWRITE, IFETCH)
  *      to reflect these values in cachesim.h so you can make your code more readable.
  */
-void cachesim_access(addr_t physical_addr, int access_type) {
-    accesses+=1;
+void cache_access(cache_t* c, addr_t physical_addr, int access_type) {
+    c->kernel(c, &physical_addr, &access_type, 1, NULL);
+}
 
-    addr_t line_addr=physical_addr/power_of_two(num_offset_bits);
-    int tag= line_addr/power_of_two(num_index_bits);
-    int index= line_addr-tag*power_of_two(num_index_bits);
+// Kernels split addresses this many at a time, and prefetch the tags of the set this
+// many accesses ahead of the one being simulated
+#define BATCH_CHUNK 256
+#define BATCH_PREFETCH_DISTANCE 8
 
-    cache_set_t* set= &(cache[index]);
-    cache_block_t* block= set->blocks;
-    lru_stack_t*stack=set->stack;
+/**
+ * Function to find the block of set <index> that holds <tag>, in a cache with <ways>
+ * ways, at most WAYS_PER_WORD. With <ways> a constant, the comparison is unrolled.
+ *
+ * @return the way holding <tag>, or -1 if it is not in the set.
+ */
+static inline __attribute__((always_inline))
+int cache_set_find_fixed(const cache_t* c, int index, addr_t tag, const int ways) {
+    const int stride=(ways+TAG_LANES-1)/TAG_LANES*TAG_LANES;
+    const unsigned int* tags=c->tag_store+(size_t)2*index*stride;
+    unsigned long long hit=0;
+    if (ways<TAG_LANES){
+      for (int i=0; i<ways; i++){
+        hit|=(unsigned long long)(tags[i]==(unsigned int)tag)<<i;
+      }
+    }
+    else{
+      hit=match_tags(tags, stride, (unsigned int)tag);
+    }
+    hit&=c->bit_store[(size_t)2*index];
+    return match_high(tags+stride, hit, (unsigned int)(tag>>32));
+}
 
-    for (int i=0; i<stack->size;i++){
-      cache_block_t* curr=&(block[i]);
+/**
+ * The access kernel all others are instances of. It performs <n> memory accesses to
+ * <c> with the same result as cache_access on each in turn. The addresses of a chunk
+ * are split up front, which lets the sets of upcoming accesses be prefetched, and the
+ * statistics are updated once per call.
+ *
+ * @param offset_bits is the number of block offset bits of <c>.
+ * @param ways is the associativity of <c>, at most WAYS_PER_WORD, or 0 to look tags up
+ *      without knowing it.
+ */
+static inline __attribute__((always_inline))
+void access_kernel(cache_t* c, const addr_t* addrs, const int* types, size_t n,
+                   unsigned char* results, const int offset_bits, const int ways) {
+    addr_t tags[BATCH_CHUNK];
+    int indexes[BATCH_CHUNK];
+    counter_t batch_hits=0;
+    counter_t batch_writebacks=0;
+    int index_bits=c->num_index_bits;
+    addr_t set_mask=(addr_t)c->num_sets-1;
+    int stride=ways ? (ways+TAG_LANES-1)/TAG_LANES*TAG_LANES : c->tag_stride;
 
-      if(tag==curr->tag && curr->valid==0){
-        lru_stack_set_mru(stack,i);
-        hits+=1;
-        if(access_type==1)
-        {
-          curr->dirty=1;
+    for (size_t base=0; base<n; base+=BATCH_CHUNK){
+      size_t len=n-base<BATCH_CHUNK ? n-base : BATCH_CHUNK;
+      for (size_t i=0; i<len; i++){
+        addr_t line_addr=addrs[base+i]>>offset_bits;
+        tags[i]=line_addr>>index_bits;
+        indexes[i]=(int)(line_addr&set_mask);
+      }
+      for (size_t i=0; i<len; i++){
+        if (i+BATCH_PREFETCH_DISTANCE<len){
+          __builtin_prefetch(c->tag_store+(size_t)2*indexes[i+BATCH_PREFETCH_DISTANCE]*stride);
+        }
+        int index=indexes[i];
+        int access_type=types ? types[base+i] : MEMREAD;
+        int way=ways ? cache_set_find_fixed(c, index, tags[i], ways)
+                     : cache_set_find(&(c->sets[index]), tags[i]);
+        int result=ACCESS_HIT;
+        if (way>=0){
+          cache_set_hit(c, index, way, access_type);
         }
-        return;
+        else{
+          addr_t evicted_tag;
+          result=cache_set_fill(c, index, tags[i], access_type==MEMWRITE, &evicted_tag)==EVICT_DIRTY
+                 ? ACCESS_WRITEBACK : ACCESS_MISS;
+        }
+        batch_hits+=result==ACCESS_HIT;
+        batch_writebacks+=result==ACCESS_WRITEBACK;
+        if (results) results[base+i]=result;
       }
     }
+    c->accesses+=n;
+    c->hits+=batch_hits;
+    c->misses+=n-batch_hits;
+    c->writebacks+=batch_writebacks;
+}
+
+static void access_kernel_generic(cache_t* c, const addr_t* addrs, const int* types, size_t n,
+                                  unsigned char* results) {
+    access_kernel(c, addrs, types, n, results, c->num_offset_bits, 0);
+}
+
+// The (block size, offset bits, ways) geometries that get a kernel of their own
+#define KERNEL_GEOMETRIES(X) \
+    X(16, 4, 1) X(16, 4, 2) X(16, 4, 4) X(16, 4, 8) X(16, 4, 16) X(16, 4, 32) X(16, 4, 64) \
+    X(32, 5, 1) X(32, 5, 2) X(32, 5, 4) X(32, 5, 8) X(32, 5, 16) X(32, 5, 32) X(32, 5, 64) \
+    X(64, 6, 1) X(64, 6, 2) X(64, 6, 4) X(64, 6, 8) X(64, 6, 16) X(64, 6, 32) X(64, 6, 64) \
+    X(128, 7, 1) X(128, 7, 2) X(128, 7, 4) X(128, 7, 8) X(128, 7, 16) X(128, 7, 32) X(128, 7, 64)
+
+#define DEFINE_KERNEL(block, offset_bits, ways) \
+    static void access_kernel_##block##_##ways(cache_t* c, const addr_t* addrs, \
+                                               const int* types, size_t n, \
+                                               unsigned char* results) { \
+        access_kernel(c, addrs, types, n, results, offset_bits, ways); \
+    }
+KERNEL_GEOMETRIES(DEFINE_KERNEL)
 
-    misses+=1;
+typedef struct kernel_entry_t {
+	int block_size;
+	int ways;
+	void (*kernel)(cache_t*, const addr_t*, const int*, size_t, unsigned char*);
+} kernel_entry_t;
 
+#define KERNEL_ENTRY(block, offset_bits, ways) { block, ways, access_kernel_##block##_##ways },
+static const kernel_entry_t kernels[]={ KERNEL_GEOMETRIES(KERNEL_ENTRY) };
 
-      for (int i=0; i<stack->size;i++){
-        cache_block_t* curr=&(block[i]);
-        if(curr->valid==1){
-          lru_stack_set_mru(stack,i);
-          curr->valid=0;
-          if (access_type==1){
-            curr->dirty=1;
-          }
-          else{
-            curr->dirty=0;
-          }
-          curr->tag=tag;
-          return;
+/**
+ * Function to pick the access kernel for the geometry of <c>: a specialized one if
+ * there is one, otherwise the generic one.
+ */
+static void select_kernel(cache_t* c) {
+    c->kernel=access_kernel_generic;
+    for (size_t i=0; i<sizeof(kernels)/sizeof(kernels[0]); i++){
+      if (kernels[i].block_size==c->block_size && kernels[i].ways==c->ways){
+        c->kernel=kernels[i].kernel;
+      }
+    }
+}
+
+/**
+ * Function to perform <n> memory accesses to <c>, with the same result as calling
+ * cache_access on each in turn. The kernel chosen for the geometry of <c> splits the
+ * addresses of a chunk up front, which lets the sets of upcoming accesses be
+ * prefetched, and updates the statistics once per batch.
+ *
+ * @param c is the cache to access.
+ * @param addrs is the address of each access.
+ * @param types is the type of each access, or NULL if all of them are MEMREAD.
+ * @param n is the number of accesses.
+ */
+void cache_access_batch(cache_t* c, const addr_t* addrs, const int* types, size_t n) {
+    cache_access_batch_results(c, addrs, types, n, NULL);
+}
+
+/**
+ * Function to perform <n> memory accesses to <c> like cache_access_batch, and also
+ * report the outcome of each.
+ *
+ * @param results is set to ACCESS_HIT, ACCESS_MISS or ACCESS_WRITEBACK for each
+ *      access, unless it is NULL.
+ */
+void cache_access_batch_results(cache_t* c, const addr_t* addrs, const int* types, size_t n,
+                                unsigned char* results) {
+    c->kernel(c, addrs, types, n, results);
+}
+
+/**
+ * @return the statistics of <c>.
+ */
+cache_stats_t cache_get_stats(const cache_t* c) {
+    cache_stats_t stats;
+    stats.accesses=c->accesses;
+    stats.hits=c->hits;
+    stats.misses=c->misses;
+    stats.writebacks=c->writebacks;
+    return stats;
+}
+
+/**
+ * Function to zero the statistics of <c>, leaving its contents alone.
+ */
+void cache_reset_stats(cache_t* c) {
+    c->accesses=0;
+    c->hits=0;
+    c->misses=0;
+    c->writebacks=0;
+}
+
+/**
+ * Function to look up <physical_addr> in <c> without filling on a miss. A hit updates
+ * the replacement state, and a MEMWRITE hit marks the block dirty. The statistics of
+ * <c> are left alone; callers that combine caches keep their own books.
+ *
+ * @return 1 on a hit, 0 on a miss.
+ */
+int cache_probe(cache_t* c, addr_t physical_addr, int access_type) {
+    addr_t tag;
+    int index;
+    split_address(c, physical_addr, &tag, &index);
+    int way=cache_set_find(&(c->sets[index]), tag);
+    if (way<0){
+      return 0;
+    }
+    cache_set_hit(c, index, way, access_type);
+    return 1;
+}
+
+/**
+ * Function to check whether <physical_addr> is in <c>, without touching the
+ * replacement state or the statistics.
+ *
+ * @return 1 if the block is in <c>, 0 otherwise.
+ */
+int cache_contains(const cache_t* c, addr_t physical_addr) {
+    addr_t tag;
+    int index;
+    split_address(c, physical_addr, &tag, &index);
+    return cache_set_find(&(c->sets[index]), tag)>=0;
+}
+
+/**
+ * Function to install the block holding <physical_addr>, which must not be in <c>.
+ * The statistics of <c> are left alone.
+ *
+ * @param dirty is 1 if the block is installed dirty.
+ * @param evicted_addr is set to the address of the evicted block, if any.
+ * @return EVICT_NONE, EVICT_CLEAN or EVICT_DIRTY.
+ */
+int cache_fill(cache_t* c, addr_t physical_addr, int dirty, addr_t* evicted_addr) {
+    addr_t tag, evicted_tag;
+    int index;
+    split_address(c, physical_addr, &tag, &index);
+    int result=cache_set_fill(c, index, tag, dirty, &evicted_tag);
+    if (result!=EVICT_NONE){
+      *evicted_addr=block_address(c, evicted_tag, index);
+    }
+    return result;
+}
+
+/**
+ * Function to mark the block holding <physical_addr> dirty, without touching the
+ * replacement state.
+ *
+ * @return 1 if the block is in <c>, 0 otherwise.
+ */
+int cache_mark_dirty(cache_t* c, addr_t physical_addr) {
+    addr_t tag;
+    int index;
+    split_address(c, physical_addr, &tag, &index);
+    cache_set_t* set=&(c->sets[index]);
+    int way=cache_set_find(set, tag);
+    if (way<0){
+      return 0;
+    }
+    set->dirty[way/WAYS_PER_WORD]|=1ULL<<(way%WAYS_PER_WORD);
+    return 1;
+}
+
+/**
+ * Function to invalidate the block holding <physical_addr>.
+ *
+ * @return -1 if the block is not in <c>, otherwise 1 if it was dirty and 0 if clean.
+ */
+int cache_invalidate(cache_t* c, addr_t physical_addr) {
+    addr_t tag;
+    int index;
+    split_address(c, physical_addr, &tag, &index);
+    cache_set_t* set=&(c->sets[index]);
+    int way=cache_set_find(set, tag);
+    if (way<0){
+      return -1;
+    }
+    unsigned long long bit=1ULL<<(way%WAYS_PER_WORD);
+    int was_dirty=(set->dirty[way/WAYS_PER_WORD]&bit)!=0;
+    if (set->index){
+      index_remove(set, way);
+    }
+    set->valid[way/WAYS_PER_WORD]&=~bit;
+    set->dirty[way/WAYS_PER_WORD]&=~bit;
+    set->num_valid-=1;
+    return was_dirty;
+}
+
+// Checkpoint files start with this header, then hold the tags, valid/dirty bits,
+// valid counts and replacement state in host byte order. Hash indexes are rebuilt
+// from the tags on restore.
+#define CHECKPOINT_MAGIC "CSIMCKP3"
+#define CHECKPOINT_POLICY_LEN 24
+
+typedef struct checkpoint_header_t {
+	char magic[8];
+	int block_size;
+	int cache_size;
+	int ways;
+	char policy[CHECKPOINT_POLICY_LEN];
+} checkpoint_header_t;
+
+/**
+ * Function to rebuild the hash indexes of <c> from its tags and valid bits.
+ */
+static void rebuild_indexes(cache_t* c) {
+    if (!c->indexes){
+      return;
+    }
+    for (int i=0; i<c->num_sets; i++){
+      cache_set_t* set=&(c->sets[i]);
+      line_map_clear(set->index);
+      for (int way=0; way<set->size; way++){
+        if ((set->valid[way/WAYS_PER_WORD]>>(way%WAYS_PER_WORD))&1){
+          index_insert(set, way);
         }
       }
-      cache_block_t* curr=&(block[lru_stack_get_lru(stack)]);
-      if(curr->dirty==1){
-        writebacks+=1;
+    }
+}
+
+/**
+ * Function to write the contents and replacement state of <c> to <filename>, so that
+ * a later run can pick up where this one left off. The statistics are not saved.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int cache_save(const cache_t* c, const char* filename) {
+    FILE* out=fopen(filename, "wb");
+    if (!out){
+      return -1;
+    }
+    checkpoint_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.block_size=c->block_size;
+    header.cache_size=c->cache_size;
+    header.ways=c->ways;
+    snprintf(header.policy, sizeof(header.policy), "%s", c->repl->policy->name);
+
+    size_t tags=(size_t)2*c->tag_stride*c->num_sets;
+    size_t bits=(size_t)2*c->bit_words*c->num_sets;
+    int ok=fwrite(&header, sizeof(header), 1, out)==1
+           && fwrite(c->tag_store, sizeof(unsigned int), tags, out)==tags
+           && fwrite(c->bit_store, sizeof(unsigned long long), bits, out)==bits;
+    for (int i=0; ok && i<c->num_sets; i++){
+      ok=fwrite(&(c->sets[i].num_valid), sizeof(int), 1, out)==1;
+    }
+    ok=ok && repl_save(c->repl, out)==0;
+    ok=(fclose(out)==0) && ok;
+    return ok ? 0 : -1;
+}
+
+/**
+ * Function to load a checkpoint written by cache_save into <c>, which must have the
+ * same geometry and replacement policy. The statistics of <c> are left alone.
+ *
+ * @return 0 on success, -1 on error (after printing why if the checkpoint does not
+ *      match <c>).
+ */
+int cache_restore(cache_t* c, const char* filename) {
+    FILE* in=fopen(filename, "rb");
+    if (!in){
+      return -1;
+    }
+    checkpoint_header_t header;
+    if (fread(&header, sizeof(header), 1, in)!=1
+        || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic))!=0){
+      fprintf(stderr, "%s is not a cache checkpoint\n", filename);
+      fclose(in);
+      return -1;
+    }
+    header.policy[CHECKPOINT_POLICY_LEN-1]='\0';
+    if (header.block_size!=c->block_size || header.cache_size!=c->cache_size
+        || header.ways!=c->ways || strcmp(header.policy, c->repl->policy->name)!=0){
+      fprintf(stderr, "%s holds a %d %d %d %s cache, not %d %d %d %s\n", filename,
+              header.block_size, header.cache_size, header.ways, header.policy,
+              c->block_size, c->cache_size, c->ways, c->repl->policy->name);
+      fclose(in);
+      return -1;
+    }
+
+    size_t tags=(size_t)2*c->tag_stride*c->num_sets;
+    size_t bits=(size_t)2*c->bit_words*c->num_sets;
+    int ok=fread(c->tag_store, sizeof(unsigned int), tags, in)==tags
+           && fread(c->bit_store, sizeof(unsigned long long), bits, in)==bits;
+    for (int i=0; ok && i<c->num_sets; i++){
+      ok=fread(&(c->sets[i].num_valid), sizeof(int), 1, in)==1;
+    }
+    ok=ok && repl_load(c->repl, in)==0;
+    fclose(in);
+    rebuild_indexes(c);
+    return ok ? 0 : -1;
+}
+
+/**
+ * Function to free up everything allocated for <c>.
+ */
+void cache_free(cache_t* c) {
+    repl_free(c->repl);
+    free(c->sets);
+    free(c->tag_store);
+    free(c->bit_store);
+    if (c->indexes){
+      for (int i=0; i<c->num_sets; i++){
+        line_map_free(&(c->indexes[i]));
       }
-      if (access_type==1){
-        curr->dirty=1;
+      free(c->indexes);
+    }
+    free(c);
+}
+
+/*
+ * Set-partitioned parallel simulation.
+ *
+ * The trace is decoded by the main thread one window at a time. Each window is cut into
+ * one chunk per worker; in the first phase every worker sorts the accesses of its chunk
+ * into per-shard buffers, where a set belongs to shard (set index % threads). In the
+ * second phase every worker simulates its own shard, visiting the buffers of all chunks
+ * in trace order. Each set therefore sees exactly the accesses, in exactly the order, it
+ * would see in the serial run, so the totals are identical. The main thread decodes the
+ * next window while the workers are busy with the current one.
+ */
+#define PARALLEL_WINDOW (1 << 20)   // Records decoded per window
+
+/**
+ * Buffer of packed accesses for one (chunk, shard) pair. Each access is packed as
+ * line_addr << 1 | is_write.
+ */
+typedef struct shard_buf_t {
+	unsigned long long* ops;
+	size_t len;
+	size_t cap;
+} shard_buf_t;
+
+typedef struct parallel_ctx_t {
+	cache_t* cache;
+	int threads;
+	const trace_record_t* window;	// Window currently being simulated
+	size_t window_len;
+	shard_buf_t* bufs;				// bufs[chunk * threads + shard]
+	int done;						// Set by the main thread to stop the workers
+	pthread_barrier_t start;		// Workers and main: a new window is ready
+	pthread_barrier_t partitioned;	// Workers only: all chunks are sorted into shards
+	pthread_barrier_t finished;		// Workers and main: the window is simulated
+} parallel_ctx_t;
+
+typedef struct parallel_worker_t {
+	parallel_ctx_t* ctx;
+	int id;
+	pthread_t thread;
+	counter_t hits;
+	counter_t misses;
+	counter_t writebacks;
+} parallel_worker_t;
+
+static void shard_buf_push(shard_buf_t* buf, unsigned long long op) {
+    if (buf->len==buf->cap){
+      buf->cap=buf->cap ? buf->cap*2 : 1024;
+      buf->ops=(unsigned long long*)realloc(buf->ops, sizeof(unsigned long long)*buf->cap);
+    }
+    buf->ops[buf->len++]=op;
+}
+
+static void* parallel_worker(void* arg) {
+    parallel_worker_t* w=(parallel_worker_t*)arg;
+    parallel_ctx_t* ctx=w->ctx;
+    int threads=ctx->threads;
+
+    for (;;){
+      pthread_barrier_wait(&ctx->start);
+      if (ctx->done){
+        break;
+      }
+
+      // Phase 1: sort this worker's chunk of the window into shards
+      size_t per_chunk=(ctx->window_len+threads-1)/threads;
+      size_t begin=per_chunk*w->id;
+      size_t end=begin+per_chunk;
+      if (begin>ctx->window_len){
+        begin=ctx->window_len;
       }
-      else{
-        curr->dirty=0;
+      if (end>ctx->window_len){
+        end=ctx->window_len;
       }
-      curr->valid=0;
-      curr->tag=tag;
-      lru_stack_set_mru(stack,lru_stack_get_lru(stack));
 
-    ////////////////////////////////////////////////////////////////////
-    //  TODO: Write the code needed to perform a cache access on your
-    //  cache simulator. Some things to remember:
-    //      - When it is a cache hit, you SHOULD NOT bring another cache
-    //        block in.
-    //      - When it is a cache miss, you should bring a new cache block
-    //        in. If the set is full, evict the LRU block.
-    //      - Remember to update all the necessary statistics as necessary
-    //      - Remember to correctly update your valid and dirty bits.
-    ////////////////////////////////////////////////////////////////////
+      shard_buf_t* mine=&(ctx->bufs[(size_t)w->id*threads]);
+      for (int i=0; i<threads; i++){
+        mine[i].len=0;
+      }
+      for (size_t i=begin; i<end; i++){
+        const trace_record_t* r=&(ctx->window[i]);
+        addr_t line_addr=r->addr>>ctx->cache->num_offset_bits;
+        int index=(int)(line_addr&(addr_t)(ctx->cache->num_sets-1));
+        // The line address, with the write flag in the bit the offset frees up
+        shard_buf_push(&(mine[index%threads]),
+                       (line_addr<<1)|(trace_record_type(r)==MEMWRITE));
+      }
+      pthread_barrier_wait(&ctx->partitioned);
+
+      // Phase 2: simulate this worker's shard, chunk by chunk in trace order
+      for (int c=0; c<threads; c++){
+        shard_buf_t* buf=&(ctx->bufs[(size_t)c*threads+w->id]);
+        for (size_t i=0; i<buf->len; i++){
+          unsigned long long op=buf->ops[i];
+          addr_t line_addr=op>>1;
+          addr_t tag=line_addr>>ctx->cache->num_index_bits;
+          int index=(int)(line_addr&(addr_t)(ctx->cache->num_sets-1));
+          int access_type=(op&1) ? MEMWRITE : MEMREAD;
+          int result=cache_set_access(ctx->cache, index, tag, access_type);
+          if (result==ACCESS_HIT){
+            w->hits+=1;
+          }
+          else{
+            w->misses+=1;
+            if (result==ACCESS_WRITEBACK){
+              w->writebacks+=1;
+            }
+          }
+        }
+      }
+      pthread_barrier_wait(&ctx->finished);
+    }
+    return NULL;
+}
+
+/**
+ * Function to run a whole trace through <c> using up to <threads> worker threads.
+ * The statistics end up exactly as if every record had gone through cache_access.
+ *
+ * @param c is the cache to simulate
+ * @param trace is the trace to simulate
+ * @param threads is the number of worker threads to use
+ * @return the number of records simulated
+ */
+counter_t cache_run_parallel(cache_t* c, trace_t* trace, int threads) {
+    if (threads>c->num_sets){
+      threads=c->num_sets;
+    }
+    // Set dueling lets sets influence each other, which sharding cannot reproduce
+    if (c->repl->policy->shared_state){
+      threads=1;
+    }
+    // One-byte blocks leave no bit of the line address free for the write flag
+    if (c->num_offset_bits==0){
+      threads=1;
+    }
+    if (threads<1){
+      threads=1;
+    }
+
+    parallel_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.cache=c;
+    ctx.threads=threads;
+    ctx.bufs=(shard_buf_t*)calloc((size_t)threads*threads, sizeof(shard_buf_t));
+    pthread_barrier_init(&ctx.start, NULL, threads+1);
+    pthread_barrier_init(&ctx.partitioned, NULL, threads);
+    pthread_barrier_init(&ctx.finished, NULL, threads+1);
+
+    parallel_worker_t* workers=(parallel_worker_t*)calloc(threads, sizeof(parallel_worker_t));
+    for (int i=0; i<threads; i++){
+      workers[i].ctx=&ctx;
+      workers[i].id=i;
+      pthread_create(&(workers[i].thread), NULL, parallel_worker, &(workers[i]));
+    }
+
+    trace_record_t* windows[2];
+    windows[0]=(trace_record_t*)malloc(sizeof(trace_record_t)*PARALLEL_WINDOW);
+    windows[1]=(trace_record_t*)malloc(sizeof(trace_record_t)*PARALLEL_WINDOW);
+
+    counter_t total=0;
+    int cur=0;
+    size_t len=trace_read(trace, windows[cur], PARALLEL_WINDOW);
+    while (len>0){
+      ctx.window=windows[cur];
+      ctx.window_len=len;
+      pthread_barrier_wait(&ctx.start);
+      // Decode the next window while the workers simulate this one
+      size_t next_len=trace_read(trace, windows[cur^1], PARALLEL_WINDOW);
+      pthread_barrier_wait(&ctx.finished);
+      total+=len;
+      cur^=1;
+      len=next_len;
+    }
+
+    ctx.done=1;
+    pthread_barrier_wait(&ctx.start);
+    for (int i=0; i<threads; i++){
+      pthread_join(workers[i].thread, NULL);
+      c->hits+=workers[i].hits;
+      c->misses+=workers[i].misses;
+      c->writebacks+=workers[i].writebacks;
+    }
+    c->accesses+=total;
+
+    for (int i=0; i<threads*threads; i++){
+      free(ctx.bufs[i].ops);
+    }
+    free(ctx.bufs);
+    free(workers);
+    free(windows[0]);
+    free(windows[1]);
+    pthread_barrier_destroy(&ctx.start);
+    pthread_barrier_destroy(&ctx.partitioned);
+    pthread_barrier_destroy(&ctx.finished);
+    return total;
+}
+
+/*
+ * The single-cache interface used by main(). It drives one global cache instance.
+ */
+cache_t* cache;     // The cache simulated by the cachesim_* functions
 
-    ////////////////////////////////////////////////////////////////////
-    //  End of your code
-    ////////////////////////////////////////////////////////////////////
+/**
+ * Function to intialize your cache simulator with the given cache parameters.
+ * Note that we will only input valid parameters and all the inputs will always
+ * be a power of 2.
+ *
+ * @param _block_size is the block size in bytes
+ * @param _cache_size is the cache size in bytes
+ * @param _ways is the associativity
+ * @param policy is the replacement policy, NULL for LRU
+ */
+void cachesim_init(int _block_size, int _cache_size, int _ways, const repl_policy_t* policy) {
+    cache = cache_create(_block_size, _cache_size, _ways, policy);
+}
+
+/**
+ * Function to perform a SINGLE memory access to the simulated cache.
+ *
+ * @param physical_addr is the address to use for the memory access.
+ * @param access_type is the type of access (MEMREAD, MEMWRITE or IFETCH).
+ */
+void cachesim_access(addr_t physical_addr, int access_type) {
+    cache_access(cache, physical_addr, access_type);
 }
 
 /**
  * Function to free up any dynamically allocated memory you allocated
  */
 void cachesim_cleanup() {
-    ////////////////////////////////////////////////////////////////////
-    //  TODO: Write the code to do any heap allocation cleanup
-    ////////////////////////////////////////////////////////////////////
-    for (int i=0;i<num_sets;i++){
-      lru_stack_cleanup(cache[i].stack);
-      free(cache[i].blocks);
-      }
-
-    ////////////////////////////////////////////////////////////////////
-    //  End of your code
-    ////////////////////////////////////////////////////////////////////
+    cache_free(cache);
+    cache = NULL;
 }
 
 /**
@@ -201,32 +1001,437 @@ void cachesim_cleanup() {
  * DO NOT update what this prints.
  */
 void cachesim_print_stats() {
+    cache_stats_t stats = cache_get_stats(cache);
+    accesses = stats.accesses;
+    hits = stats.hits;
+    misses = stats.misses;
+    writebacks = stats.writebacks;
     printf("%llu, %llu, %llu, %llu\n", accesses, hits, misses, writebacks);
 }
 
 /**
- * Function to open the trace file
- * You do not need to update this function.
+ * Runs every record of <trace> through a simulator.
+ *
+ * @param trace is the trace to simulate
+ * @param access is the simulator's access function, e.g. cachesim_access
+ * @return the number of records simulated
  */
-FILE *open_trace(const char *filename) {
-    return fopen(filename, "r");
+counter_t simulate_trace(trace_t* trace, void (*access)(addr_t, int)) {
+    const trace_record_t* batch;
+    size_t n;
+    counter_t total = 0;
+    while ((n = trace_next_batch(trace, &batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            access(batch[i].addr, trace_record_type(&batch[i]));
+        }
+        total += n;
+    }
+    return total;
 }
 
 /**
- * Read in next line of the trace
+ * Runs every record of <trace> through <c>, one trace batch at a time.
  *
- * @param trace is the file handler for the trace
- * @return 0 when error or EOF and 1 otherwise.
+ * @return the number of records simulated
  */
-int next_line(FILE* trace) {
-    if (feof(trace) || ferror(trace)) return 0;
-    else {
-        int t;
-        unsigned long long address, instr;
-        fscanf(trace, "%d %llx %llx\n", &t, &address, &instr);
-        cachesim_access(address, t);
+counter_t simulate_trace_batched(trace_t* trace, cache_t* c) {
+    addr_t addrs[TRACE_BATCH_SIZE];
+    int types[TRACE_BATCH_SIZE];
+    const trace_record_t* batch;
+    size_t n;
+    counter_t total = 0;
+    while ((n = trace_next_batch(trace, &batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            addrs[i] = batch[i].addr;
+            types[i] = trace_record_type(&batch[i]);
+        }
+        cache_access_batch(c, addrs, types, n);
+        total += n;
     }
-    return 1;
+    return total;
+}
+
+/**
+ * Runs every record of <trace> through the prefetching cache <pf>.
+ *
+ * @return the number of records simulated
+ */
+counter_t simulate_trace_prefetch(trace_t* trace, prefetch_t* pf) {
+    const trace_record_t* batch;
+    size_t n;
+    counter_t total = 0;
+    while ((n = trace_next_batch(trace, &batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            prefetch_access(pf, batch[i].addr, trace_record_type(&batch[i]),
+                            trace_record_instr(&batch[i]));
+        }
+        total += n;
+    }
+    return total;
+}
+
+/**
+ * Runs every record of <trace> through the write path <wp>.
+ *
+ * @return the number of records simulated
+ */
+counter_t simulate_trace_write_path(trace_t* trace, write_path_t* wp) {
+    const trace_record_t* batch;
+    size_t n;
+    counter_t total = 0;
+    while ((n = trace_next_batch(trace, &batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            write_path_access(wp, batch[i].addr, trace_record_type(&batch[i]));
+        }
+        total += n;
+    }
+    write_path_flush(wp);
+    return total;
+}
+
+/**
+ * Runs every record of <trace> through <c>, classifying each miss with <cl>, charging
+ * each access to its PC in <prof> and reporting intervals with <iv>. Any of them may
+ * be NULL.
+ *
+ * @return the number of records simulated
+ */
+counter_t simulate_trace_observed(trace_t* trace, cache_t* c, classify_t* cl, pc_profile_t* prof,
+                                  interval_t* iv) {
+    addr_t addrs[TRACE_BATCH_SIZE];
+    int types[TRACE_BATCH_SIZE];
+    unsigned char results[TRACE_BATCH_SIZE];
+    const trace_record_t* batch;
+    size_t n;
+    counter_t total = 0;
+    while ((n = trace_next_batch(trace, &batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            addrs[i] = batch[i].addr;
+            types[i] = trace_record_type(&batch[i]);
+        }
+        cache_access_batch_results(c, addrs, types, n, results);
+        if (cl) classify_access_batch(cl, addrs, results, n);
+        if (prof) {
+            for (size_t i = 0; i < n; i++) {
+                pc_profile_access(prof, trace_record_instr(&batch[i]), results[i]);
+            }
+        }
+        if (iv) interval_record(iv, types, results, n);
+        total += n;
+    }
+    if (iv) interval_finish(iv);
+    return total;
+}
+
+/**
+ * @returns the current time in seconds from a monotonic clock.
+ */
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Runs sweep mode: decodes <trace_name> once and simulates every configuration in
+ * <spec> against it. Configurations that do not name a policy use <policy>.
+ *
+ * @return the exit status for main
+ */
+int run_sweep(const char* spec, const char* trace_name, const repl_policy_t* policy,
+              int threads, int report_throughput) {
+    sweep_config_t* configs;
+    int num_configs = sweep_parse_configs(spec, policy, &configs);
+    if (num_configs < 0) {
+        fprintf(stderr, "Unable to parse configurations: %s\n", spec);
+        return 1;
+    }
+
+    trace_t* input = trace_open(trace_name);
+    if (!input) {
+        perror("Unable to open trace file");
+        free(configs);
+        return 1;
+    }
+
+    double start = now_seconds();
+    size_t count;
+    const trace_record_t* records = trace_load(input, &count);
+    if (!records || trace_error(input)) {
+        if (records) {
+            fprintf(stderr, "%s\n", trace_error(input));
+        } else {
+            fprintf(stderr, "Out of memory decoding %s\n", trace_name);
+        }
+        trace_close(input);
+        free(configs);
+        return 1;
+    }
+    double decoded = now_seconds();
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    sweep_run(records, count, configs, num_configs, threads, stdout);
+
+    if (report_throughput) {
+        double elapsed = now_seconds() - decoded;
+        fprintf(stderr, "decoded %zu records in %.3f s; %d configurations in %.3f s"
+                        " (%.2f M accesses/s)\n",
+                count, decoded - start, num_configs, elapsed,
+                elapsed > 0 ? (double)count * num_configs / elapsed / 1e6 : 0.0);
+    }
+    trace_close(input);
+    free(configs);
+    return 0;
+}
+
+/**
+ * Runs hierarchy mode: simulates <trace_name> on the hierarchy described by <spec>,
+ * and times it with the model described by <timing_spec> unless that is NULL.
+ *
+ * @return the exit status for main
+ */
+int run_hierarchy(const char* spec, const char* trace_name, const repl_policy_t* policy,
+                  const char* timing_spec, int report_throughput) {
+    hierarchy_t* h = hierarchy_create(spec, policy);
+    if (!h) return 1;
+    timing_t* timing = NULL;
+    if (timing_spec && !(timing = timing_create(h, timing_spec))) {
+        fprintf(stderr, "Invalid timing model: %s\n", timing_spec);
+        hierarchy_free(h);
+        return 1;
+    }
+
+    trace_t* input = trace_open(trace_name);
+    if (!input) {
+        perror("Unable to open trace file");
+        timing_free(timing);
+        hierarchy_free(h);
+        return 1;
+    }
+
+    double start = now_seconds();
+    const trace_record_t* batch;
+    size_t n;
+    while ((n = trace_next_batch(input, &batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (timing) {
+                timing_access(timing, batch[i].addr, trace_record_type(&batch[i]));
+            } else {
+                hierarchy_access(h, batch[i].addr, trace_record_type(&batch[i]));
+            }
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    int status = 0;
+    if (trace_error(input)) {
+        fprintf(stderr, "%s\n", trace_error(input));
+        status = 1;
+    } else {
+        hierarchy_print_stats(h, stdout);
+        if (timing) timing_print_stats(timing, stdout);
+    }
+    if (report_throughput) {
+        fprintf(stderr, "%s trace: %llu accesses in %.3f s (%.2f M accesses/s)\n",
+                input->binary ? "binary" : "streamed", h->accesses, elapsed,
+                elapsed > 0 ? h->accesses / elapsed / 1e6 : 0.0);
+    }
+    trace_close(input);
+    timing_free(timing);
+    hierarchy_free(h);
+    return status;
+}
+
+/**
+ * Runs analytics mode: analyzes <count> records of <trace_name> after the first <skip>,
+ * with lines of <block_size> bytes.
+ *
+ * @return the exit status for main
+ */
+int run_analyze(const char* spec, const char* trace_name, int block_size, size_t skip,
+                size_t count, int report_throughput) {
+    analyze_t* a = analyze_create(spec, block_size);
+    if (!a) {
+        fprintf(stderr, "Invalid analysis: %s\n", spec);
+        return 1;
+    }
+
+    trace_t* input = trace_open(trace_name);
+    if (!input) {
+        perror("Unable to open trace file");
+        analyze_free(a);
+        return 1;
+    }
+    trace_skip(input, skip);
+    trace_set_limit(input, count);
+
+    double start = now_seconds();
+    counter_t total = analyze_run(a, input);
+    double elapsed = now_seconds() - start;
+
+    int status = 0;
+    if (trace_error(input)) {
+        fprintf(stderr, "%s\n", trace_error(input));
+        status = 1;
+    } else {
+        analyze_print(a, stdout);
+    }
+    if (report_throughput) {
+        fprintf(stderr, "%s trace: %llu accesses in %.3f s (%.2f M accesses/s)\n",
+                input->binary ? "binary" : "streamed", total, elapsed,
+                elapsed > 0 ? total / elapsed / 1e6 : 0.0);
+    }
+    trace_close(input);
+    analyze_free(a);
+    return status;
+}
+
+/**
+ * Runs multi-core mode: simulates the cores described by <spec>, one per trace in
+ * <trace_names>, or as many as a single trace with a core column names.
+ *
+ * @return the exit status for main
+ */
+int run_multicore(const char* spec, char** trace_names, int num_traces,
+                  const repl_policy_t* policy, int threads, int report_throughput) {
+    trace_record_t* tagged[MC_MAX_CORES] = { NULL };
+    unsigned long long* seqs[MC_MAX_CORES] = { NULL };
+    trace_t* inputs[MC_MAX_CORES] = { NULL };
+    const trace_record_t* records[MC_MAX_CORES];
+    size_t counts[MC_MAX_CORES];
+    int num_cores = num_traces;
+    int status = 1;
+
+    if (num_traces > MC_MAX_CORES) {
+        fprintf(stderr, "At most %d traces are supported\n", MC_MAX_CORES);
+        return 1;
+    }
+    if (num_traces == 1) {
+        num_cores = multicore_load_tagged_trace(trace_names[0], tagged, seqs, counts);
+        if (num_cores <= 0) {
+            fprintf(stderr, "Unable to read %s as a trace with a core column\n", trace_names[0]);
+            goto out;
+        }
+        for (int c = 0; c < num_cores; c++) {
+            records[c] = tagged[c];
+        }
+    } else {
+        for (int c = 0; c < num_cores; c++) {
+            inputs[c] = trace_open(trace_names[c]);
+            if (!inputs[c] || !(records[c] = trace_load(inputs[c], &counts[c]))) {
+                fprintf(stderr, "Unable to read trace file %s\n", trace_names[c]);
+                goto out;
+            }
+            if (trace_error(inputs[c])) {
+                fprintf(stderr, "%s\n", trace_error(inputs[c]));
+                goto out;
+            }
+        }
+    }
+
+    multicore_t* mc = multicore_create(spec, num_cores, policy, threads);
+    if (!mc) goto out;
+    double start = now_seconds();
+    multicore_run(mc, records, num_traces == 1 ? (const unsigned long long* const*)seqs : NULL,
+                  counts);
+    double elapsed = now_seconds() - start;
+    multicore_print_stats(mc, stdout);
+    if (report_throughput) {
+        counter_t total = 0;
+        for (int c = 0; c < num_cores; c++) {
+            total += counts[c];
+        }
+        fprintf(stderr, "%d cores: %llu accesses in %.3f s (%.2f M accesses/s)\n", num_cores,
+                total, elapsed, elapsed > 0 ? total / elapsed / 1e6 : 0.0);
+    }
+    multicore_free(mc);
+    status = 0;
+
+out:
+    for (int c = 0; c < MC_MAX_CORES; c++) {
+        free(tagged[c]);
+        free(seqs[c]);
+        trace_close(inputs[c]);
+    }
+    return status;
+}
+
+void print_usage(const char* prog) {
+    fprintf(stderr, "Usage:\n  %s [-t] [-C] [-P top[:entries]]"
+                    " [-I accesses[:format[:file]]] [-S sample]"
+                    " [-R skip[:warmup[:count]]] [-i checkpoint] [-o checkpoint] [-j threads] [-r policy] [-p prefetcher]"
+                    " [-w write policy] [-v entries] [-b entries] <trace> <block size(bytes)>"
+                    " <cache size(bytes)> <ways>\n"
+                    "  %s -d [-t] <trace> <block size(bytes)>"
+                    " <max cache size(bytes)> <max ways>\n"
+                    "  %s -s <configs> [-j threads] [-r policy] <trace>\n"
+                    "  %s -H <levels> [-T mshrs[:window]] [-t] [-r policy] <trace>\n"
+                    "  %s -m <cores> [-j threads] [-t] [-r policy] <trace> [<trace> ...]\n"
+                    "  %s -A <window>[:<max keys>] [-t] [-R skip[:0[:count]]] <trace>"
+                    " <block size(bytes)>\n"
+                    "  %s -c <trace> <binary trace>\n"
+                    "A <trace> is a text or binary trace, either of them optionally gzip or\n"
+                    "zstd compressed, or - for standard input, plain or gzip compressed\n"
+                    "Options:\n"
+                    "  -t  report simulation throughput on stderr\n"
+                    "  -j  simulate with this many threads, sharding the cache by set.\n"
+                    "      Only for a single cache without -p, -w, -v, -b, -C, -P, -I\n"
+                    "      or -S, and for -s and -m\n"
+                    "  -r  replacement policy (default lru), one of:\n      ",
+                    prog, prog, prog, prog, prog, prog, prog);
+    repl_print_names(stderr, ", ");
+    fprintf(stderr, "\n"
+                    "  -p  prefetcher, as name[:degree[:distance[:latency]]], one of:\n      ");
+    prefetch_print_names(stderr, ", ");
+    fprintf(stderr, "\n"
+                    "      prefetch statistics are printed after the cache statistics\n"
+                    "  -w  write policy: wb-wa (default), wb-nwa, wt-wa or wt-nwa\n"
+                    "  -v  add a fully associative victim cache of this many blocks\n"
+                    "  -b  add a coalescing write buffer of this many blocks\n"
+                    "      with -w, -v or -b, next-level traffic is printed after the\n"
+                    "      cache statistics\n"
+                    "  -C  classify misses as compulsory, capacity or conflict and print\n"
+                    "      the counts after the cache statistics\n"
+                    "  -P  print the <top> PCs with the most misses (all for every PC)\n"
+                    "      after the cache statistics. With <entries>, track at most\n"
+                    "      that many PCs in a heavy-hitters sketch\n"
+                    "  -I  every <accesses> accesses, report that interval's hits, misses,\n"
+                    "      writebacks and per-type counts as csv (default) or jsonl, to\n"
+                    "      <file> or standard output\n"
+                    "  -S  sampled simulation: sets:<ratio> simulates one set in <ratio>,\n"
+                    "      time:<period>:<detail>[:<warmup>] warms up on <warmup> and\n"
+                    "      measures <detail> of every <period> accesses. Prints estimated\n"
+                    "      statistics, then the rates with 95%% confidence intervals\n"
+                    "  -R  skip the first <skip> records, warm the cache up on the next\n"
+                    "      <warmup> without counting them, then simulate <count> records\n"
+                    "      (default: the rest of the trace)\n"
+                    "  -i  restore the cache contents and replacement state from a\n"
+                    "      checkpoint before simulating\n"
+                    "  -o  save the cache contents and replacement state to a checkpoint\n"
+                    "      after simulating\n"
+                    "  -d  stack-distance mode: report hits and misses for every\n"
+                    "      power-of-two cache size and associativity in one pass\n"
+                    "  -s  sweep mode: simulate every configuration in <configs> and\n"
+                    "      print one CSV line each. <configs> is a file of\n"
+                    "      \"<block> <size> <ways>\" lines or a BLOCKS:SIZES:WAYS grid\n"
+                    "      such as 64:1024-65536:1,2,4-16\n"
+                    "  -H  hierarchy mode: simulate split L1s, an L2 and an LLC and\n"
+                    "      print per-level statistics and the AMAT. <levels> is a file\n"
+                    "      or list of level:block:size:ways[:policy[:latency[:inclusion]]]\n"
+                    "      such as l1i:64:32768:8,l1d:64:32768:8,l2:64:262144:8::12:inclusive\n"
+                    "      with inclusion nine, inclusive or exclusive, plus mem:<latency>\n"
+                    "  -T  with -H, estimate cycles with this many MSHRs per L1 and at\n"
+                    "      most <window> accesses in flight (default 128)\n"
+                    "  -m  multi-core mode: private coherent L1s and a shared L2. <cores>\n"
+                    "      is a list such as l1:64:32768:8,l2:64:1048576:16,moesi,directory\n"
+                    "      (protocol mesi or moesi, interconnect bus or directory, and an\n"
+                    "      optional quantum:<accesses>). Give one trace per core, or one\n"
+                    "      text trace with the core id as a fourth column\n"
+                    "  -A  analytics mode: print line and page reuse distance histograms,\n"
+                    "      the distinct lines and pages of every <window> accesses, and\n"
+                    "      the most common strides of each access type. Tracks at most\n"
+                    "      <max keys> lines and pages (default 1048576)\n"
+                    "  -c  convert a trace to the binary format and exit\n");
 }
 
 /**
@@ -237,19 +1442,364 @@ int next_line(FILE* trace) {
  * @returns 0 on success.
  */
 int main(int argc, char **argv) {
-    FILE *input;
+    const char* prog = argv[0];
+    int report_throughput = 0;
+    int convert = 0;
+    int stack_distance = 0;
+    int classify = 0;
+    const char* profile_spec = NULL;
+    const char* interval_spec = NULL;
+    const char* sample_spec = NULL;
+    const char* analyze_spec = NULL;
+    const char* region_spec = NULL;
+    const char* restore_file = NULL;
+    const char* save_file = NULL;
+    int threads = 0;
+    const char* sweep_spec = NULL;
+    const char* hierarchy_spec = NULL;
+    const char* prefetch_spec = NULL;
+    const char* timing_spec = NULL;
+    const char* multicore_spec = NULL;
+    const char* write_policy = NULL;
+    int victims = 0;
+    int wbuf_depth = 0;
+    const repl_policy_t* policy = repl_find("lru");
+    int opt;
+
+    while ((opt = getopt(argc, argv, "tcCdj:s:S:P:I:A:R:i:o:H:T:m:r:p:w:v:b:h")) != -1) {
+        switch (opt) {
+        case 't':
+            report_throughput = 1;
+            break;
+        case 'c':
+            convert = 1;
+            break;
+        case 'C':
+            classify = 1;
+            break;
+        case 'P':
+            profile_spec = optarg;
+            break;
+        case 'I':
+            interval_spec = optarg;
+            break;
+        case 'S':
+            sample_spec = optarg;
+            break;
+        case 'A':
+            analyze_spec = optarg;
+            break;
+        case 'R':
+            region_spec = optarg;
+            break;
+        case 'i':
+            restore_file = optarg;
+            break;
+        case 'o':
+            save_file = optarg;
+            break;
+        case 'd':
+            stack_distance = 1;
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 's':
+            sweep_spec = optarg;
+            break;
+        case 'H':
+            hierarchy_spec = optarg;
+            break;
+        case 'm':
+            multicore_spec = optarg;
+            break;
+        case 'T':
+            timing_spec = optarg;
+            break;
+        case 'p':
+            prefetch_spec = optarg;
+            break;
+        case 'w':
+            write_policy = optarg;
+            break;
+        case 'v':
+            victims = atoi(optarg);
+            break;
+        case 'b':
+            wbuf_depth = atoi(optarg);
+            break;
+        case 'r':
+            policy = repl_find(optarg);
+            if (!policy) {
+                fprintf(stderr, "Unknown replacement policy: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(prog);
+            return 1;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (convert) {
+        if (argc != 2) {
+            print_usage(prog);
+            return 1;
+        }
+        double start = now_seconds();
+        long long n = trace_convert(argv[0], argv[1]);
+        if (n < 0) {
+            perror("Unable to convert trace");
+            return 1;
+        }
+        if (report_throughput) {
+            double elapsed = now_seconds() - start;
+            fprintf(stderr, "converted %lld records in %.3f s\n", n, elapsed);
+        }
+        return 0;
+    }
 
-    if (argc != 5) {
-        fprintf(stderr, "Usage:\n  %s <trace> <block size(bytes)>"
-                        " <cache size(bytes)> <ways>\n", argv[0]);
+    // Options a mode does not model are rejected rather than silently ignored
+    const char* mode = sweep_spec ? "-s" : multicore_spec ? "-m" : hierarchy_spec ? "-H"
+                       : analyze_spec ? "-A" : stack_distance ? "-d" : NULL;
+    int single_cache_only = prefetch_spec || write_policy || victims || wbuf_depth
+                            || classify || profile_spec || interval_spec || sample_spec;
+    if (mode && single_cache_only) {
+        fprintf(stderr, "-p, -w, -v, -b, -C, -P, -I and -S cannot be combined with %s\n", mode);
+        return 1;
+    }
+    if (threads > 1 && (single_cache_only || (mode && !sweep_spec && !multicore_spec))) {
+        fprintf(stderr, "-j only applies to a plain single cache, -s and -m\n");
+        return 1;
+    }
+    if (timing_spec && !hierarchy_spec) {
+        fprintf(stderr, "-T only applies to -H\n");
+        return 1;
+    }
+    if ((region_spec || restore_file || save_file)
+        && (sweep_spec || multicore_spec || hierarchy_spec)) {
+        fprintf(stderr, "-R, -i and -o only apply to a single cache\n");
+        return 1;
+    }
+    size_t skip = 0, warmup = 0, count = SIZE_MAX;
+    if (region_spec) {
+        // <skip>[:<warmup>[:<count>]]
+        unsigned long long fields[3] = { 0, 0, SIZE_MAX };
+        const char* p = region_spec;
+        char* end;
+        int n = 0;
+        for (;;) {
+            fields[n++] = strtoull(p, &end, 10);
+            if (end == p || *p == '-' || *end != ':' || n == 3) break;
+            p = end + 1;
+        }
+        if (end == p || *p == '-' || *end) {
+            fprintf(stderr, "Invalid region: %s\n", region_spec);
+            return 1;
+        }
+        skip = (size_t)fields[0];
+        warmup = (size_t)fields[1];
+        count = (size_t)fields[2];
+    }
+    if ((warmup || restore_file || save_file) && stack_distance) {
+        fprintf(stderr, "-d cannot be combined with a warmup, -i or -o\n");
         return 1;
     }
 
-    input = open_trace(argv[1]);
-    cachesim_init(atol(argv[2]), atol(argv[3]), atol(argv[4]));
-    while (next_line(input));
-    cachesim_print_stats();
-    cachesim_cleanup();
-    fclose(input);
-    return 0;
+    if (analyze_spec) {
+        if (argc != 2) {
+            print_usage(prog);
+            return 1;
+        }
+        if (warmup || restore_file || save_file) {
+            fprintf(stderr, "-A cannot be combined with a warmup, -i or -o\n");
+            return 1;
+        }
+        return run_analyze(analyze_spec, argv[0], atoi(argv[1]), skip, count,
+                           report_throughput);
+    }
+
+    if (sweep_spec) {
+        if (argc != 1) {
+            print_usage(prog);
+            return 1;
+        }
+        return run_sweep(sweep_spec, argv[0], policy, threads, report_throughput);
+    }
+
+    if (multicore_spec) {
+        if (argc < 1) {
+            print_usage(prog);
+            return 1;
+        }
+        return run_multicore(multicore_spec, argv, argc, policy, threads, report_throughput);
+    }
+
+    if (hierarchy_spec) {
+        if (argc != 1) {
+            print_usage(prog);
+            return 1;
+        }
+        return run_hierarchy(hierarchy_spec, argv[0], policy, timing_spec, report_throughput);
+    }
+
+    if (argc != 4) {
+        print_usage(prog);
+        return 1;
+    }
+
+    trace_t* input = trace_open(argv[0]);
+    if (!input) {
+        perror("Unable to open trace file");
+        return 1;
+    }
+    prefetch_t* pf = NULL;
+    write_path_t* wp = NULL;
+    classify_t* cl = NULL;
+    pc_profile_t* prof = NULL;
+    interval_t* iv = NULL;
+    sample_t* smp = NULL;
+    size_t profile_top = 0;
+    size_t profile_entries = 0;
+    int model_writes = write_policy || victims || wbuf_depth;
+    if (model_writes && prefetch_spec) {
+        fprintf(stderr, "-p cannot be combined with -w, -v or -b\n");
+        trace_close(input);
+        return 1;
+    }
+    int observe = classify || profile_spec || interval_spec;
+    if (observe && (model_writes || prefetch_spec || stack_distance)) {
+        fprintf(stderr, "-C, -P and -I cannot be combined with -d, -p, -w, -v or -b\n");
+        trace_close(input);
+        return 1;
+    }
+    if (sample_spec && (observe || model_writes || prefetch_spec || stack_distance)) {
+        fprintf(stderr, "-S cannot be combined with -d, -p, -w, -v, -b, -C, -P or -I\n");
+        trace_close(input);
+        return 1;
+    }
+    if (profile_spec) {
+        // <top> is a count or "all", optionally followed by :<entries>
+        char* end = (char*)profile_spec + 3;
+        long top = 0;
+        long entries = 0;
+        if (strncmp(profile_spec, "all", 3) != 0) top = strtol(profile_spec, &end, 10);
+        if (*end == ':') entries = strtol(end + 1, &end, 10);
+        if (*end || top < 0 || entries < 0 || end == profile_spec) {
+            fprintf(stderr, "Invalid PC profile: %s\n", profile_spec);
+            trace_close(input);
+            return 1;
+        }
+        profile_top = (size_t)top;
+        profile_entries = (size_t)entries;
+    }
+    if (stack_distance) {
+        mrc_init(atol(argv[1]), atol(argv[2]), atol(argv[3]));
+    } else {
+        cachesim_init(atol(argv[1]), atol(argv[2]), atol(argv[3]), policy);
+        if (restore_file && cache_restore(cache, restore_file) < 0) {
+            fprintf(stderr, "Unable to restore checkpoint %s\n", restore_file);
+            cachesim_cleanup();
+            trace_close(input);
+            return 1;
+        }
+        if (prefetch_spec && !(pf = prefetch_create(prefetch_spec, cache))) {
+            fprintf(stderr, "Invalid prefetcher: %s\n", prefetch_spec);
+            cachesim_cleanup();
+            trace_close(input);
+            return 1;
+        }
+        if (model_writes && !(wp = write_path_create(cache, write_policy ? write_policy : "wb-wa",
+                                                     victims, wbuf_depth))) {
+            fprintf(stderr, "Invalid write policy, victim cache or write buffer\n");
+            cachesim_cleanup();
+            trace_close(input);
+            return 1;
+        }
+        if (classify) cl = classify_create(cache);
+        if (profile_spec) prof = pc_profile_create(profile_entries);
+        if (interval_spec && !(iv = interval_create(interval_spec))) {
+            fprintf(stderr, "Invalid interval report: %s\n", interval_spec);
+            classify_free(cl);
+            pc_profile_free(prof);
+            cachesim_cleanup();
+            trace_close(input);
+            return 1;
+        }
+        if (sample_spec && !(smp = sample_create(sample_spec, cache))) {
+            fprintf(stderr, "Invalid sampling: %s\n", sample_spec);
+            cachesim_cleanup();
+            trace_close(input);
+            return 1;
+        }
+    }
+
+    trace_skip(input, skip);
+    if (warmup) {
+        trace_set_limit(input, warmup);
+        simulate_trace_batched(input, cache);
+        cache_reset_stats(cache);
+    }
+    trace_set_limit(input, count);
+
+    double start = now_seconds();
+    counter_t total;
+    if (stack_distance) {
+        total = simulate_trace(input, mrc_access);
+    } else if (pf) {
+        // Prefetches cut across sets, so a prefetching cache is simulated serially
+        total = simulate_trace_prefetch(input, pf);
+    } else if (wp) {
+        total = simulate_trace_write_path(input, wp);
+    } else if (smp) {
+        total = sample_run(smp, input);
+    } else if (observe) {
+        // Observers see accesses in trace order across all sets, so they cannot be sharded
+        total = simulate_trace_observed(input, cache, cl, prof, iv);
+    } else if (threads > 1) {
+        total = cache_run_parallel(cache, input, threads);
+    } else {
+        total = simulate_trace_batched(input, cache);
+    }
+    double elapsed = now_seconds() - start;
+
+    if (trace_error(input)) {
+        // Statistics of the records before the error would pass for the whole trace's
+        fprintf(stderr, "%s\n", trace_error(input));
+    } else if (stack_distance) {
+        mrc_print_stats();
+    } else if (smp) {
+        sample_print_stats(smp, stdout);
+    } else {
+        cachesim_print_stats();
+        if (pf) prefetch_print_stats(pf, stdout);
+        if (wp) write_path_print_stats(wp, stdout);
+        if (cl) classify_print_stats(cl, stdout);
+        if (prof) pc_profile_print(prof, profile_top, stdout);
+    }
+    if (report_throughput) {
+        fprintf(stderr, "%s trace: %llu accesses in %.3f s (%.2f M accesses/s)\n",
+                input->binary ? "binary" : "streamed", total, elapsed,
+                elapsed > 0 ? total / elapsed / 1e6 : 0.0);
+    }
+    int status = trace_error(input) ? 1 : 0;
+    if (save_file && !status && cache_save(cache, save_file) < 0) {
+        perror("Unable to save checkpoint");
+        status = 1;
+    }
+    if (stack_distance) {
+        mrc_cleanup();
+    } else {
+        prefetch_free(pf);
+        write_path_free(wp);
+        classify_free(cl);
+        pc_profile_free(prof);
+        interval_free(iv);
+        sample_free(smp);
+        cachesim_cleanup();
+    }
+    trace_close(input);
+    return status;
 }
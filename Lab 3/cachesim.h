@@ -10,35 +10,125 @@
 #define MEMWRITE 1
 #define IFETCH 2
 
+#include "linemap.h"
 #include "lrustack.h"
+#include "replacement.h"
+#include "trace.h"
 
 // Please DO NOT CHANGE the following two typedefs
 typedef unsigned long long addr_t;		// Data type to hold addresses
 typedef unsigned long long counter_t;	// Data type to hold cache statistic variables
 
-/**
- * Struct for a cache block. Feel free to change any of this if you want. 
- */
-typedef struct cache_block_t {
-	int tag;
-	int valid;
-	int dirty;
-} cache_block_t;
+// Tags are 64 bits, kept as separate low and high 32-bit halves. The low halves are
+// compared TAG_LANES at a time, so each set's tag arrays are padded to a multiple of
+// TAG_LANES, and only ways whose low half matches have their high half checked.
+// Valid and dirty bits are packed 64 ways to a word.
+#define TAG_LANES 8
+#define WAYS_PER_WORD 64
+
+// Sets with more ways than this also keep a hash index from tag to way, so lookups
+// and evictions stay O(1) however associative the cache is.
+#define HASHED_WAYS_THRESHOLD 64
 
 /**
- * Struct for a cache set. Feel free to change any of this if you want. 
+ * Struct for a cache set. The blocks are stored as a structure of arrays so that
+ * a lookup compares many tags with one vector instruction: block i has the tag whose
+ * halves are tags[i] and tags_high[i], and is valid/dirty if bit i of valid/dirty is
+ * set.
  */
 typedef struct cache_set_t {
-	int size;				// Number of blocks in this cache set
-	lru_stack_t* stack;		// LRU Stack 
-	cache_block_t* blocks;	// Array of cache block structs. You will need to
-							// 	dynamically allocate based on number of blocks
-							//	per set. 
+	int size;					// Number of blocks in this cache set
+	void* repl_state;			// This set's replacement policy state
+	unsigned int* tags;			// Low tag halves, padded to a multiple of TAG_LANES
+	unsigned int* tags_high;	// High tag halves, same layout as tags
+	unsigned long long* valid;	// Valid bits, one word per WAYS_PER_WORD blocks
+	unsigned long long* dirty;	// Dirty bits, same layout as valid
+	int num_valid;				// Number of valid blocks
+	line_map_t* index;			// Hashed sets only: tag to way, NULL otherwise
 } cache_set_t;
 
-void cachesim_init(int block_size, int cache_size, int ways);
+/**
+ * The parameters a cache is created from. All sizes are powers of two.
+ */
+typedef struct cache_config_t {
+	int block_size;		// Block size in bytes
+	int cache_size;		// Cache size in bytes
+	int ways;			// Associativity
+	const repl_policy_t* policy;	// Replacement policy, NULL for LRU
+} cache_config_t;
+
+/**
+ * A snapshot of a cache's statistics.
+ */
+typedef struct cache_stats_t {
+	counter_t accesses;		// Total number of cache accesses
+	counter_t hits;			// Total number of cache hits
+	counter_t misses;		// Total number of cache misses
+	counter_t writebacks;	// Total number of writebacks
+} cache_stats_t;
+
+/**
+ * A whole cache: its geometry, its sets and its statistics. Caches share no state,
+ * so any number of them can be simulated at once, each from its own thread. The
+ * instance API is cache_create_from_config, cache_access_batch (or cache_access for
+ * one access), cache_get_stats and cache_free.
+ */
+typedef struct cache_t {
+	int block_size;			// Block size in bytes
+	int cache_size;			// Cache size in bytes
+	int ways;				// Associativity
+	int num_blocks;			// Number of blocks
+	int num_sets;			// Number of sets
+	int num_offset_bits;	// Number of offset bits
+	int num_index_bits;		// Number of index bits
+	cache_set_t* sets;		// Array of num_sets cache sets
+	int tag_stride;			// Tags per set, ways rounded up to TAG_LANES
+	int bit_words;			// Valid/dirty words per set
+	unsigned int* tag_store;	// Tag halves of all sets, set i's at 2 * i * tag_stride
+	unsigned long long* bit_store;	// Valid then dirty bits of all sets
+	line_map_t* indexes;	// Hash indexes of all sets, NULL if sets are not hashed
+	repl_t* repl;			// Replacement policy state of all sets
+	void (*kernel)(struct cache_t* c, const addr_t* addrs, const int* types, size_t n,
+	               unsigned char* results);	// Access kernel chosen for this geometry
+	counter_t accesses;		// Total number of cache accesses
+	counter_t hits;			// Total number of cache hits
+	counter_t misses;		// Total number of cache misses
+	counter_t writebacks;	// Total number of writebacks
+} cache_t;
+
+// Outcomes of a single access, as reported by cache_access_batch_results
+#define ACCESS_HIT 0
+#define ACCESS_MISS 1
+#define ACCESS_WRITEBACK 2     // A miss that evicted a dirty block
+
+// What cache_fill had to evict to make room
+#define EVICT_NONE 0
+#define EVICT_CLEAN 1
+#define EVICT_DIRTY 2
+
+cache_t* cache_create(int block_size, int cache_size, int ways, const repl_policy_t* policy);
+cache_t* cache_create_from_config(const cache_config_t* config);
+void cache_access(cache_t* c, addr_t physical_addr, int access_type);
+void cache_access_batch(cache_t* c, const addr_t* addrs, const int* types, size_t n);
+void cache_access_batch_results(cache_t* c, const addr_t* addrs, const int* types, size_t n,
+                                unsigned char* results);
+cache_stats_t cache_get_stats(const cache_t* c);
+void cache_reset_stats(cache_t* c);
+int cache_probe(cache_t* c, addr_t physical_addr, int access_type);
+int cache_contains(const cache_t* c, addr_t physical_addr);
+int cache_fill(cache_t* c, addr_t physical_addr, int dirty, addr_t* evicted_addr);
+int cache_mark_dirty(cache_t* c, addr_t physical_addr);
+int cache_invalidate(cache_t* c, addr_t physical_addr);
+int cache_save(const cache_t* c, const char* filename);
+int cache_restore(cache_t* c, const char* filename);
+void cache_free(cache_t* c);
+counter_t cache_run_parallel(cache_t* c, trace_t* trace, int threads);
+
+void cachesim_init(int block_size, int cache_size, int ways, const repl_policy_t* policy);
 void cachesim_access(addr_t physical_add, int access_type);
 void cachesim_cleanup(void);
 void cachesim_print_stats(void);
 
+double now_seconds(void);
+
 #endif
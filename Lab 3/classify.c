@@ -0,0 +1,118 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "classify.h"
+
+// Seen lines are kept as bitmaps over chunks of 2^SEEN_CHUNK_BITS neighbouring lines,
+// one 64-byte cache line of bits per chunk
+#define SEEN_CHUNK_BITS 9
+#define SEEN_CHUNK_WORDS ((1 << SEEN_CHUNK_BITS) / 64)
+#define INITIAL_SEEN_CHUNKS 64
+
+// classify_access_batch prefetches the map and seen chunk entries twice this many
+// accesses ahead, then the seen bits once they can be found, this many accesses ahead
+#define PREFETCH_DISTANCE 8
+
+classify_t* classify_create(const cache_t* c) {
+    classify_t* cl = (classify_t*)calloc(1, sizeof(classify_t));
+    cl->num_offset_bits = c->num_offset_bits;
+    cl->num_blocks = c->num_blocks;
+    cl->lru = init_lru_stack(c->num_blocks);
+    cl->slot_lines = (addr_t*)calloc(c->num_blocks, sizeof(addr_t));
+
+    line_map_init(&cl->map, c->num_blocks, 1);
+    line_map_init(&cl->seen_chunks, INITIAL_SEEN_CHUNKS, 1);
+    cl->seen_capacity = INITIAL_SEEN_CHUNKS;
+    cl->seen_bits = (unsigned long long*)calloc(cl->seen_capacity * SEEN_CHUNK_WORDS,
+                                                sizeof(unsigned long long));
+    return cl;
+}
+
+/**
+ * Function to mark <line> as seen.
+ *
+ * @return 1 if <line> had not been seen before, 0 otherwise.
+ */
+static int mark_seen(classify_t* cl, addr_t line) {
+    long long chunk = line_map_find(&cl->seen_chunks, line >> SEEN_CHUNK_BITS);
+    if (chunk < 0) {
+        if (cl->num_seen_chunks == cl->seen_capacity) {
+            size_t words = cl->seen_capacity * SEEN_CHUNK_WORDS;
+            cl->seen_bits = (unsigned long long*)realloc(cl->seen_bits,
+                                                         2 * words * sizeof(unsigned long long));
+            memset(cl->seen_bits + words, 0, words * sizeof(unsigned long long));
+            cl->seen_capacity *= 2;
+        }
+        chunk = (long long)cl->num_seen_chunks++;
+        line_map_insert(&cl->seen_chunks, line >> SEEN_CHUNK_BITS, chunk);
+    }
+    unsigned long long* word = &cl->seen_bits[chunk * SEEN_CHUNK_WORDS
+                                              + ((line >> 6) & (SEEN_CHUNK_WORDS - 1))];
+    unsigned long long bit = 1ULL << (line & 63);
+    if (*word & bit) return 0;
+    *word |= bit;
+    return 1;
+}
+
+void classify_access(classify_t* cl, addr_t physical_addr, int missed) {
+    addr_t line = physical_addr >> cl->num_offset_bits;
+
+    int block = (int)line_map_find(&cl->map, line);
+    int shadow_missed = block < 0;
+    if (shadow_missed) {
+        // Recycle the shadow cache's LRU slot
+        block = lru_stack_get_lru(cl->lru);
+        if (cl->slot_lines[block]) line_map_remove(&cl->map, cl->slot_lines[block] - 1, NULL);
+        cl->slot_lines[block] = line + 1;
+        line_map_insert(&cl->map, line, block);
+    }
+    lru_stack_set_mru(cl->lru, block);
+
+    // A line the shadow cache holds has been seen, so only its misses can be new lines
+    int first_touch = shadow_missed && mark_seen(cl, line);
+    if (!missed) return;
+    if (first_touch) {
+        cl->compulsory++;
+    } else if (shadow_missed) {
+        cl->capacity++;
+    } else {
+        cl->conflict++;
+    }
+}
+
+void classify_access_batch(classify_t* cl, const addr_t* addrs, const unsigned char* missed,
+                           size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (i + 2 * PREFETCH_DISTANCE < n) {
+            addr_t ahead = addrs[i + 2 * PREFETCH_DISTANCE] >> cl->num_offset_bits;
+            __builtin_prefetch(&cl->map.keys[line_map_home(&cl->map, ahead)]);
+            __builtin_prefetch(&cl->seen_chunks.keys[line_map_home(&cl->seen_chunks,
+                                                                   ahead >> SEEN_CHUNK_BITS)]);
+        }
+        if (i + PREFETCH_DISTANCE < n) {
+            addr_t ahead = addrs[i + PREFETCH_DISTANCE] >> cl->num_offset_bits;
+            long long chunk = line_map_find(&cl->seen_chunks, ahead >> SEEN_CHUNK_BITS);
+            if (chunk >= 0) __builtin_prefetch(&cl->seen_bits[chunk * SEEN_CHUNK_WORDS]);
+        }
+        classify_access(cl, addrs[i], missed[i]);
+    }
+}
+
+void classify_print_stats(const classify_t* cl, FILE* out) {
+    fprintf(out, "compulsory, capacity, conflict\n");
+    fprintf(out, "%llu, %llu, %llu\n", cl->compulsory, cl->capacity, cl->conflict);
+}
+
+void classify_free(classify_t* cl) {
+    if (!cl) return;
+    lru_stack_cleanup(cl->lru);
+    free(cl->slot_lines);
+    line_map_free(&cl->map);
+    line_map_free(&cl->seen_chunks);
+    free(cl->seen_bits);
+    free(cl);
+}
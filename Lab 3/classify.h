@@ -0,0 +1,85 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __CLASSIFY_H
+#define __CLASSIFY_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * 3C miss classification. Every miss of the cache being simulated is one of
+ *  - compulsory: the first access to its line anywhere in the trace
+ *  - capacity:   not compulsory, and a fully associative LRU cache with the same
+ *                number of blocks would have missed too
+ *  - conflict:   every other miss, i.e. one that only the mapping into sets caused
+ *
+ * The fully associative cache is a shadow: it sees every access but holds no data. It
+ * is an lru_stack_t over its block slots, so a hit promotes and a miss recycles the
+ * LRU slot in O(1), plus a line_map_t from line address to slot. Lines seen so far
+ * are kept as bitmaps over chunks of 512 neighbouring lines, found through a second
+ * line_map_t, so a dense footprint costs about one bit per line.
+ *
+ * Classifying is not cheap. Every shadow miss updates the map and the seen bits, so a
+ * classified run takes about 2.5x as long as a plain one on a trace that mostly hits,
+ * about 3.5x on one that mostly misses, and more when the lines seen no longer fit in
+ * the host's caches.
+ */
+
+typedef struct classify_t {
+	int num_offset_bits;	// Offset bits of the cache classified
+	int num_blocks;			// Blocks in the shadow cache
+	lru_stack_t* lru;		// Recency order of the shadow cache's slots
+	addr_t* slot_lines;		// Line held by each slot, stored as line + 1, 0 if empty
+	line_map_t map;			// Line to slot of the lines the shadow cache holds
+	line_map_t seen_chunks;	// Chunk of neighbouring lines to its index in seen_bits
+	unsigned long long* seen_bits;	// One bit per line of each chunk, set once it is seen
+	size_t num_seen_chunks;	// Chunks in seen_bits
+	size_t seen_capacity;	// Chunks seen_bits has room for
+	counter_t compulsory;	// Misses on lines never seen before
+	counter_t capacity;		// Other misses the shadow cache also took
+	counter_t conflict;		// The remaining misses
+} classify_t;
+
+/**
+ * Function to create a classifier for misses of <c>. The shadow cache has as many
+ * blocks as <c>.
+ *
+ * @return the dynamically allocated classifier.
+ */
+classify_t* classify_create(const cache_t* c);
+
+/**
+ * Function to show the classifier a SINGLE access and, if the cache missed on it,
+ * classify the miss. Every access must be shown, hits included, in trace order.
+ *
+ * @param physical_addr is the address of the memory access.
+ * @param missed is nonzero if the cache missed.
+ */
+void classify_access(classify_t* cl, addr_t physical_addr, int missed);
+
+/**
+ * Function to show the classifier <n> accesses, with the same result as calling
+ * classify_access on each in turn. The shadow map entries of upcoming accesses are
+ * prefetched.
+ *
+ * @param addrs is the address of each access.
+ * @param missed is nonzero for each access the cache missed, as in the results of
+ *      cache_access_batch_results.
+ */
+void classify_access_batch(classify_t* cl, const addr_t* addrs, const unsigned char* missed,
+                           size_t n);
+
+/**
+ * Function to print the compulsory, capacity and conflict miss counts as a CSV
+ * header and line.
+ */
+void classify_print_stats(const classify_t* cl, FILE* out);
+
+/**
+ * Function to free <cl>.
+ */
+void classify_free(classify_t* cl);
+
+#endif
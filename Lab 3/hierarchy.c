@@ -0,0 +1,272 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hierarchy.h"
+
+static const char* level_names[HIER_LEVELS] = { "l1i", "l1d", "l2", "llc" };
+static const int default_latency[HIER_LEVELS] = { 4, 4, 12, 40 };
+static const char* inclusion_names[] = { "nine", "inclusive", "exclusive" };
+
+#define DEFAULT_MEMORY_LATENCY 200
+#define MAX_LEVEL_FIELDS 7
+#define MAX_SPEC_LEN 4096
+
+static int is_power_of_two(long x) {
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+/**
+ * Function to split <token> at every ':' into at most MAX_LEVEL_FIELDS fields. Empty
+ * fields are kept, so "l2:64:262144:8::12" has an empty policy.
+ *
+ * @return the number of fields, or -1 if there are too many.
+ */
+static int split_fields(char* token, char** fields) {
+    int n = 0;
+    for (;;) {
+        if (n == MAX_LEVEL_FIELDS) return -1;
+        fields[n++] = token;
+        char* colon = strchr(token, ':');
+        if (!colon) return n;
+        *colon = '\0';
+        token = colon + 1;
+    }
+}
+
+/**
+ * Function to parse one level description into <h>.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int parse_level(hierarchy_t* h, char* token, const repl_policy_t* policy) {
+    char* fields[MAX_LEVEL_FIELDS];
+    int n = split_fields(token, fields);
+    if (n < 0) return -1;
+
+    if (strcmp(fields[0], "mem") == 0) {
+        if (n != 2) return -1;
+        h->memory_latency = atoi(fields[1]);
+        return h->memory_latency >= 0 ? 0 : -1;
+    }
+
+    int k = 0;
+    while (k < HIER_LEVELS && strcmp(fields[0], level_names[k]) != 0) k++;
+    if (k == HIER_LEVELS || n < 4 || h->levels[k].cache) return -1;
+
+    int block_size = atoi(fields[1]);
+    int cache_size = atoi(fields[2]);
+    int ways = atoi(fields[3]);
+    if (!is_power_of_two(block_size) || !is_power_of_two(cache_size) || !is_power_of_two(ways)
+        || (long)block_size * ways > cache_size) {
+        return -1;
+    }
+    if (n > 4 && fields[4][0] && !(policy = repl_find(fields[4]))) return -1;
+
+    hier_level_t* level = &h->levels[k];
+    level->latency = n > 5 && fields[5][0] ? atoi(fields[5]) : default_latency[k];
+    level->inclusion = INCLUSION_NINE;
+    if (n > 6 && fields[6][0]) {
+        while (level->inclusion <= INCLUSION_EXCLUSIVE
+               && strcmp(fields[6], inclusion_names[level->inclusion]) != 0) {
+            level->inclusion++;
+        }
+        // The L1s have no levels above them to be inclusive or exclusive of
+        if (level->inclusion > INCLUSION_EXCLUSIVE || k < HIER_L2) return -1;
+    }
+    if (level->latency < 0) return -1;
+    level->cache = cache_create(block_size, cache_size, ways, policy);
+    return level->cache ? 0 : -1;
+}
+
+/**
+ * Function to read <spec> into <buf>, from the file it names if there is one. Comments
+ * are dropped and line breaks become level separators.
+ *
+ * @return 0 on success, -1 if the file is too long.
+ */
+static int read_spec(const char* spec, char* buf) {
+    FILE* file = fopen(spec, "r");
+    if (!file) {
+        if (strlen(spec) >= MAX_SPEC_LEN) return -1;
+        strcpy(buf, spec);
+        return 0;
+    }
+
+    size_t len = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "#\n")] = '\0';
+        size_t n = strlen(line);
+        if (len + n + 2 > MAX_SPEC_LEN) {
+            fclose(file);
+            return -1;
+        }
+        memcpy(buf + len, line, n);
+        len += n;
+        buf[len++] = ',';
+    }
+    buf[len] = '\0';
+    fclose(file);
+    return 0;
+}
+
+hierarchy_t* hierarchy_create(const char* spec, const repl_policy_t* policy) {
+    hierarchy_t* h = (hierarchy_t*)calloc(1, sizeof(hierarchy_t));
+    h->memory_latency = DEFAULT_MEMORY_LATENCY;
+
+    char buf[MAX_SPEC_LEN];
+    if (read_spec(spec, buf) < 0) {
+        fprintf(stderr, "Hierarchy description too long: %s\n", spec);
+        hierarchy_free(h);
+        return NULL;
+    }
+    char* save;
+    for (char* token = strtok_r(buf, ", \t\r", &save); token;
+         token = strtok_r(NULL, ", \t\r", &save)) {
+        char copy[256];
+        snprintf(copy, sizeof(copy), "%s", token);
+        if (parse_level(h, token, policy) < 0) {
+            fprintf(stderr, "Invalid hierarchy level: %s\n", copy);
+            hierarchy_free(h);
+            return NULL;
+        }
+    }
+
+    if (!h->levels[HIER_L1I].cache || !h->levels[HIER_L1D].cache) {
+        fprintf(stderr, "A hierarchy needs both an l1i and an l1d\n");
+        hierarchy_free(h);
+        return NULL;
+    }
+    int block_size = h->levels[HIER_L1I].cache->block_size;
+    for (int k = 0; k < HIER_LEVELS; k++) {
+        if (h->levels[k].cache && h->levels[k].cache->block_size != block_size) {
+            fprintf(stderr, "All hierarchy levels must use the same block size\n");
+            hierarchy_free(h);
+            return NULL;
+        }
+    }
+    return h;
+}
+
+/**
+ * @return the level below level <k>, or -1 for memory.
+ */
+static int next_level(const hierarchy_t* h, int k) {
+    for (int j = k < HIER_L2 ? HIER_L2 : k + 1; j < HIER_LEVELS; j++) {
+        if (h->levels[j].cache) return j;
+    }
+    return -1;
+}
+
+static void install(hierarchy_t* h, int k, addr_t addr, int dirty);
+
+/**
+ * Function to write the dirty block at <addr> back into level <k>, or memory if <k>
+ * is -1. The block is allocated if the level does not hold it.
+ */
+static void write_back(hierarchy_t* h, int k, addr_t addr) {
+    if (k < 0) {
+        h->memory_writes++;
+    } else if (!cache_mark_dirty(h->levels[k].cache, addr)) {
+        install(h, k, addr, 1);
+    }
+}
+
+/**
+ * Function to fill the block at <addr> into level <k> and deal with whatever that
+ * evicts: an inclusive level invalidates the victim above, a dirty victim is written
+ * back, and a clean victim drops into the level below if that level is exclusive.
+ */
+static void install(hierarchy_t* h, int k, addr_t addr, int dirty) {
+    hier_level_t* level = &h->levels[k];
+    addr_t victim;
+    int evicted = cache_fill(level->cache, addr, dirty, &victim);
+    if (evicted == EVICT_NONE) return;
+
+    int victim_dirty = evicted == EVICT_DIRTY;
+    if (level->inclusion == INCLUSION_INCLUSIVE) {
+        for (int j = 0; j < k; j++) {
+            if (!h->levels[j].cache) continue;
+            int was_dirty = cache_invalidate(h->levels[j].cache, victim);
+            if (was_dirty >= 0) {
+                level->invalidations++;
+                // The copy above is newer, so its data goes down instead
+                victim_dirty |= was_dirty;
+            }
+        }
+    }
+
+    int below = next_level(h, k);
+    if (victim_dirty) {
+        level->cache->writebacks++;
+        write_back(h, below, victim);
+    } else if (below >= 0 && h->levels[below].inclusion == INCLUSION_EXCLUSIVE) {
+        install(h, below, victim, 0);
+    }
+}
+
+int hierarchy_access(hierarchy_t* h, addr_t physical_addr, int access_type) {
+    int missed[HIER_LEVELS];
+    int num_missed = 0;
+    int latency = 0;
+    int dirty = 0;      // Set if the block comes up dirty out of an exclusive level
+
+    h->accesses++;
+    int k = access_type == IFETCH ? HIER_L1I : HIER_L1D;
+    for (; k >= 0; k = next_level(h, k)) {
+        hier_level_t* level = &h->levels[k];
+        cache_t* c = level->cache;
+        c->accesses++;
+        latency += level->latency;
+        // Below the L1 the access is a read of the whole block
+        if (cache_probe(c, physical_addr, num_missed ? MEMREAD : access_type)) {
+            c->hits++;
+            if (level->inclusion == INCLUSION_EXCLUSIVE) {
+                dirty = cache_invalidate(c, physical_addr);
+            }
+            break;
+        }
+        c->misses++;
+        missed[num_missed++] = k;
+    }
+    if (k < 0) {
+        h->memory_reads++;
+        latency += h->memory_latency;
+    }
+    h->cycles += latency;
+
+    // Fill bottom up. Exclusive levels only take blocks evicted from above.
+    for (int i = num_missed - 1; i >= 0; i--) {
+        int j = missed[i];
+        if (h->levels[j].inclusion == INCLUSION_EXCLUSIVE) continue;
+        install(h, j, physical_addr, dirty || (i == 0 && access_type == MEMWRITE));
+        dirty = 0;
+    }
+    return latency;
+}
+
+void hierarchy_print_stats(const hierarchy_t* h, FILE* out) {
+    fprintf(out, "level, accesses, hits, misses, writebacks, invalidations\n");
+    for (int k = 0; k < HIER_LEVELS; k++) {
+        const hier_level_t* level = &h->levels[k];
+        if (!level->cache) continue;
+        fprintf(out, "%s, %llu, %llu, %llu, %llu, %llu\n", level_names[k],
+                level->cache->accesses, level->cache->hits, level->cache->misses,
+                level->cache->writebacks, level->invalidations);
+    }
+    fprintf(out, "memory_reads, memory_writes, amat\n");
+    fprintf(out, "%llu, %llu, %.3f\n", h->memory_reads, h->memory_writes,
+            h->accesses ? (double)h->cycles / h->accesses : 0.0);
+}
+
+void hierarchy_free(hierarchy_t* h) {
+    if (!h) return;
+    for (int k = 0; k < HIER_LEVELS; k++) {
+        if (h->levels[k].cache) cache_free(h->levels[k].cache);
+    }
+    free(h);
+}
@@ -0,0 +1,95 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __HIERARCHY_H
+#define __HIERARCHY_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * Multi-level cache hierarchies: split L1 instruction and data caches, an optional
+ * unified L2 and an optional last-level cache in front of memory. IFETCH accesses go
+ * to the L1I, MEMREAD and MEMWRITE accesses to the L1D. A miss is looked up in each
+ * level below in turn and the block is then filled on the way back up.
+ *
+ * Every level has its own geometry, replacement policy and hit latency. All levels
+ * must use the same block size. The L2 and LLC also have an inclusion mode relative
+ * to the levels above them:
+ *
+ *  - nine:      non-inclusive non-exclusive, blocks are filled at every level and
+ *               evicted independently
+ *  - inclusive: evicting a block also invalidates it in every level above
+ *  - exclusive: the level is only filled with blocks evicted from the level above,
+ *               and a hit moves the block up and out of the level
+ *
+ * Dirty blocks are written back to the next level down when evicted, and allocated
+ * there if it does not hold them. The L1s are write-allocate.
+ */
+
+#define HIER_L1I 0
+#define HIER_L1D 1
+#define HIER_L2 2
+#define HIER_LLC 3
+#define HIER_LEVELS 4
+
+#define INCLUSION_NINE 0
+#define INCLUSION_INCLUSIVE 1
+#define INCLUSION_EXCLUSIVE 2
+
+typedef struct hier_level_t {
+	cache_t* cache;			// NULL if the hierarchy has no such level
+	int latency;			// Hit latency in cycles
+	int inclusion;			// Inclusion mode relative to the levels above
+	counter_t invalidations;	// Blocks this level's evictions invalidated above
+} hier_level_t;
+
+typedef struct hierarchy_t {
+	hier_level_t levels[HIER_LEVELS];
+	int memory_latency;			// Memory access latency in cycles
+	counter_t accesses;			// Total number of accesses
+	counter_t cycles;			// Total cycles spent on accesses
+	counter_t memory_reads;		// Blocks read from memory
+	counter_t memory_writes;	// Blocks written back to memory
+} hierarchy_t;
+
+/**
+ * Function to create a hierarchy from <spec>. <spec> is either the name of a file with
+ * one level per line or a comma separated list of levels, each of the form
+ *
+ *     <level>:<block size>:<cache size>:<ways>[:<policy>[:<latency>[:<inclusion>]]]
+ *
+ * where <level> is l1i, l1d, l2 or llc, plus an optional mem:<latency>. Empty fields
+ * take the defaults: <policy>, latencies of 4, 12, 40 and 200 cycles for the L1s, L2,
+ * LLC and memory, and nine. The L1I and L1D are required.
+ *
+ * @param spec is the file name or list of levels
+ * @param policy is the policy of levels that do not name one
+ * @return the dynamically allocated hierarchy, or NULL (after printing why) if <spec>
+ *      could not be parsed
+ */
+hierarchy_t* hierarchy_create(const char* spec, const repl_policy_t* policy);
+
+/**
+ * Function to perform a SINGLE memory access to the hierarchy.
+ *
+ * @param physical_addr is the address to use for the memory access.
+ * @param access_type is the type of access (MEMREAD, MEMWRITE or IFETCH).
+ * @return the latency of the access in cycles: the hit latency of every level looked
+ *      up, plus the memory latency if no level hit.
+ */
+int hierarchy_access(hierarchy_t* h, addr_t physical_addr, int access_type);
+
+/**
+ * Function to print one CSV line of statistics per level, followed by the memory
+ * traffic and the average memory access time.
+ */
+void hierarchy_print_stats(const hierarchy_t* h, FILE* out);
+
+/**
+ * Function to free the hierarchy and all of its caches.
+ */
+void hierarchy_free(hierarchy_t* h);
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "interval.h"
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+static const char* format_names[] = { "csv", "jsonl" };
+
+interval_t* interval_create(const char* spec) {
+    char* end;
+    long long period = strtoll(spec, &end, 10);
+    if (end == spec || period < 1) return NULL;
+
+    int format = INTERVAL_CSV;
+    const char* filename = NULL;
+    if (*end == ':') {
+        const char* name = end + 1;
+        size_t len = strcspn(name, ":");
+        for (format = INTERVAL_CSV; format <= INTERVAL_JSONL; format++) {
+            if (strlen(format_names[format]) == len && strncmp(name, format_names[format], len) == 0) {
+                break;
+            }
+        }
+        if (format > INTERVAL_JSONL) return NULL;
+        if (name[len] == ':') filename = name + len + 1;
+    } else if (*end) {
+        return NULL;
+    }
+
+    interval_t* iv = (interval_t*)calloc(1, sizeof(interval_t));
+    iv->format = format;
+    iv->period = (counter_t)period;
+    iv->out = stdout;
+    if (filename && *filename && strcmp(filename, "-") != 0) {
+        iv->out = fopen(filename, "w");
+        if (!iv->out) {
+            free(iv);
+            return NULL;
+        }
+        iv->own_out = 1;
+        // Records are small and many, so write them out in large blocks
+        iv->buffer = (char*)malloc(OUTPUT_BUFFER_SIZE);
+        setvbuf(iv->out, iv->buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+    }
+    if (format == INTERVAL_CSV) {
+        fprintf(iv->out, "interval, start, accesses, hits, misses, writebacks, miss_rate,"
+                         " reads, read_misses, writes, write_misses, ifetches, ifetch_misses\n");
+    }
+    return iv;
+}
+
+/**
+ * Function to write the record of the current interval and start the next one.
+ */
+static void emit(interval_t* iv) {
+    counter_t accesses = iv->accesses[MEMREAD] + iv->accesses[MEMWRITE] + iv->accesses[IFETCH];
+    counter_t misses = iv->misses[MEMREAD] + iv->misses[MEMWRITE] + iv->misses[IFETCH];
+    double miss_rate = accesses ? (double)misses / accesses : 0.0;
+    if (iv->format == INTERVAL_CSV) {
+        fprintf(iv->out, "%llu, %llu, %llu, %llu, %llu, %llu, %.6f, %llu, %llu, %llu, %llu,"
+                         " %llu, %llu\n",
+                iv->index, iv->start, accesses, accesses - misses, misses, iv->writebacks,
+                miss_rate, iv->accesses[MEMREAD], iv->misses[MEMREAD], iv->accesses[MEMWRITE],
+                iv->misses[MEMWRITE], iv->accesses[IFETCH], iv->misses[IFETCH]);
+    } else {
+        fprintf(iv->out, "{\"interval\":%llu,\"start\":%llu,\"accesses\":%llu,\"hits\":%llu,"
+                         "\"misses\":%llu,\"writebacks\":%llu,\"miss_rate\":%.6f,"
+                         "\"reads\":%llu,\"read_misses\":%llu,\"writes\":%llu,"
+                         "\"write_misses\":%llu,\"ifetches\":%llu,\"ifetch_misses\":%llu}\n",
+                iv->index, iv->start, accesses, accesses - misses, misses, iv->writebacks,
+                miss_rate, iv->accesses[MEMREAD], iv->misses[MEMREAD], iv->accesses[MEMWRITE],
+                iv->misses[MEMWRITE], iv->accesses[IFETCH], iv->misses[IFETCH]);
+    }
+    iv->index++;
+    iv->start += accesses;
+    memset(iv->accesses, 0, sizeof(iv->accesses));
+    memset(iv->misses, 0, sizeof(iv->misses));
+    iv->writebacks = 0;
+}
+
+void interval_record(interval_t* iv, const int* types, const unsigned char* results, size_t n) {
+    counter_t left = iv->period
+                     - (iv->accesses[MEMREAD] + iv->accesses[MEMWRITE] + iv->accesses[IFETCH]);
+    for (size_t i = 0; i < n; i++) {
+        // Anything that is not a write or an instruction fetch is simulated as a read
+        int type = types[i] == MEMWRITE || types[i] == IFETCH ? types[i] : MEMREAD;
+        iv->accesses[type]++;
+        iv->misses[type] += results[i] != ACCESS_HIT;
+        iv->writebacks += results[i] == ACCESS_WRITEBACK;
+        if (--left == 0) {
+            emit(iv);
+            left = iv->period;
+        }
+    }
+}
+
+void interval_finish(interval_t* iv) {
+    if (iv->accesses[MEMREAD] + iv->accesses[MEMWRITE] + iv->accesses[IFETCH]) emit(iv);
+    fflush(iv->out);
+}
+
+void interval_free(interval_t* iv) {
+    if (!iv) return;
+    if (iv->own_out) fclose(iv->out);
+    free(iv->buffer);
+    free(iv);
+}
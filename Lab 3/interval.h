@@ -0,0 +1,67 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __INTERVAL_H
+#define __INTERVAL_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * Interval statistics. Every <period> accesses one record is written with what the
+ * cache did over that interval: accesses, hits, misses, writebacks and miss rate, and
+ * accesses and misses of each access type. A last, shorter interval covers whatever
+ * is left at the end of the trace.
+ *
+ * Records are CSV lines under a header, or JSON objects one per line. The output is
+ * fully buffered through a large stdio buffer, so writing it costs little next to the
+ * simulation.
+ */
+
+#define INTERVAL_CSV 0
+#define INTERVAL_JSONL 1
+
+typedef struct interval_t {
+	FILE* out;					// Where records go
+	int own_out;				// 1 if <out> was opened here and must be closed
+	char* buffer;				// stdio buffer of <out>
+	int format;					// INTERVAL_CSV or INTERVAL_JSONL
+	counter_t period;			// Accesses per interval
+	counter_t index;			// Number of the current interval
+	counter_t start;			// Access the current interval starts at
+	counter_t accesses[3];		// Accesses of each type this interval
+	counter_t misses[3];		// Misses of each type this interval
+	counter_t writebacks;		// Writebacks this interval
+} interval_t;
+
+/**
+ * Function to create an interval reporter from <spec>,
+ * "<period>[:<format>[:<file>]]", where <format> is csv (the default) or jsonl and
+ * <file> defaults to standard output.
+ *
+ * @return the dynamically allocated reporter, or NULL if <spec> is invalid or the
+ *      file cannot be opened.
+ */
+interval_t* interval_create(const char* spec);
+
+/**
+ * Function to record the outcomes of <n> accesses, writing a record each time an
+ * interval fills up.
+ *
+ * @param types is the type of each access.
+ * @param results is the outcome of each access, as from cache_access_batch_results.
+ */
+void interval_record(interval_t* iv, const int* types, const unsigned char* results, size_t n);
+
+/**
+ * Function to write the last interval, if it is not empty, and flush the output.
+ */
+void interval_finish(interval_t* iv);
+
+/**
+ * Function to free <iv>, closing its file if it opened one.
+ */
+void interval_free(interval_t* iv);
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "linemap.h"
+
+void line_map_init(line_map_t* m, size_t entries, int has_values) {
+    size_t size = 2;
+    while (size < 2 * entries) size <<= 1;
+    m->keys = (unsigned long long*)calloc(size, sizeof(unsigned long long));
+    m->values = has_values ? (long long*)malloc(sizeof(long long) * size) : NULL;
+    m->mask = size - 1;
+    m->used = 0;
+}
+
+void line_map_clear(line_map_t* m) {
+    memset(m->keys, 0, sizeof(unsigned long long) * (m->mask + 1));
+    m->used = 0;
+}
+
+void line_map_free(line_map_t* m) {
+    free(m->keys);
+    free(m->values);
+}
+
+void line_map_grow(line_map_t* m) {
+    line_map_t old = *m;
+    line_map_init(m, old.mask + 1, old.values != NULL);
+    for (size_t i = 0; i <= old.mask; i++) {
+        if (!old.keys[i]) continue;
+        size_t slot = line_map_slot(m, old.keys[i] - 1);
+        m->keys[slot] = old.keys[i];
+        if (m->values) m->values[slot] = old.values[i];
+    }
+    m->used = old.used;
+    line_map_free(&old);
+}
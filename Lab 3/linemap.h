@@ -0,0 +1,120 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __LINEMAP_H
+#define __LINEMAP_H
+
+#include <stddef.h>
+
+/**
+ * An open-addressed hash map from line addresses (or any other 64-bit keys) to 64-bit
+ * values, or a set of keys if it is created without values. Keys are stored as key + 1
+ * so that 0 can mark an empty slot, and collisions probe linearly.
+ *
+ * The table doubles whenever an insert would make it more than half full, so probe
+ * runs stay short. A map created for at most n keys never grows. Removing a key shifts
+ * later entries of its probe run back into the hole, so lookups never stop early at an
+ * empty slot and no tombstones build up.
+ */
+
+typedef struct line_map_t {
+	unsigned long long* keys;	// Keys stored as key + 1, 0 if the slot is empty
+	long long* values;			// Value of each key, NULL for a set
+	size_t mask;				// Table size - 1
+	size_t used;				// Keys in the table
+} line_map_t;
+
+/**
+ * Function to initialize <m> with room for <entries> keys without growing.
+ *
+ * @param has_values is 0 for a set, which stores no values.
+ */
+void line_map_init(line_map_t* m, size_t entries, int has_values);
+
+/**
+ * Function to remove every key from <m>.
+ */
+void line_map_clear(line_map_t* m);
+
+/**
+ * Function to free the tables of <m>.
+ */
+void line_map_free(line_map_t* m);
+
+/**
+ * Function to double the table of <m> and rehash every key. line_map_insert calls it.
+ */
+void line_map_grow(line_map_t* m);
+
+/**
+ * @return the slot where the probe for <key> starts, e.g. to prefetch it.
+ */
+static inline size_t line_map_home(const line_map_t* m, unsigned long long key) {
+    return (unsigned int)((key * 0x9e3779b97f4a7c15ULL) >> 32) & m->mask;
+}
+
+/**
+ * @return the slot holding <key>, or the empty slot that ends its probe run.
+ */
+static inline size_t line_map_slot(const line_map_t* m, unsigned long long key) {
+    size_t slot = line_map_home(m, key);
+    while (m->keys[slot] && m->keys[slot] != key + 1) {
+        slot = (slot + 1) & m->mask;
+    }
+    return slot;
+}
+
+/**
+ * @return the value of <key> (0 in a set), or -1 if <key> is not in <m>.
+ */
+static inline long long line_map_find(const line_map_t* m, unsigned long long key) {
+    size_t slot = line_map_slot(m, key);
+    if (!m->keys[slot]) return -1;
+    return m->values ? m->values[slot] : 0;
+}
+
+/**
+ * Function to set the value of <key> to <value>, adding <key> if it is not in <m>.
+ *
+ * @return 1 if <key> was added, 0 if it was already in <m>.
+ */
+static inline int line_map_insert(line_map_t* m, unsigned long long key, long long value) {
+    size_t slot = line_map_slot(m, key);
+    int added = !m->keys[slot];
+    if (added && 2 * (m->used + 1) > m->mask + 1) {
+        line_map_grow(m);
+        slot = line_map_slot(m, key);
+    }
+    m->keys[slot] = key + 1;
+    if (m->values) m->values[slot] = value;
+    m->used += added;
+    return added;
+}
+
+/**
+ * Function to remove <key> from <m>.
+ *
+ * @param value is set to the value <key> had, if it is not NULL and <key> was in <m>.
+ * @return 1 if <key> was removed, 0 if it was not in <m>.
+ */
+static inline int line_map_remove(line_map_t* m, unsigned long long key, long long* value) {
+    size_t mask = m->mask;
+    size_t hole = line_map_slot(m, key);
+    if (!m->keys[hole]) return 0;
+    if (value && m->values) *value = m->values[hole];
+    for (size_t slot = (hole + 1) & mask; m->keys[slot]; slot = (slot + 1) & mask) {
+        size_t home = line_map_home(m, m->keys[slot] - 1);
+        // The entry can fill the hole unless its home lies cyclically in (hole, slot]
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            m->keys[hole] = m->keys[slot];
+            if (m->values) m->values[hole] = m->values[slot];
+            hole = slot;
+        }
+    }
+    m->keys[hole] = 0;
+    m->used--;
+    return 1;
+}
+
+#endif
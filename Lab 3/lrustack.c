@@ -4,6 +4,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "lrustack.h"
 
 
@@ -33,26 +34,36 @@
  * @return the dynamically allocated stack.
  */
 lru_stack_t* init_lru_stack(int size) {
-    //  Use malloc to dynamically allocate a lru_stack_t
-	lru_stack_t* stack = (lru_stack_t*) malloc(sizeof(lru_stack_t));
+    //  Use malloc to dynamically allocate a lru_stack_t, with room for the links
+	return init_lru_stack_at(malloc(lru_stack_bytes(size)), size);
+}
+
+size_t lru_stack_bytes(int size) {
+	return sizeof(lru_stack_t) + sizeof(int) * 2 * size;
+}
+
+lru_stack_t* init_lru_stack_at(void* mem, int size) {
+	lru_stack_t* stack = (lru_stack_t*) mem;
     //  Set the stack size the caller passed in
 	stack->size = size;
-	stack->values= (int*)malloc(sizeof(int)*size);
+	stack->prev = stack->links;
+	stack->next = stack->links + size;
 
+	// Start out with block 0 as MRU down to block size-1 as LRU
 	for (int i=0; i<size; i++){
-		stack->values[i]=i;
+		stack->prev[i] = i - 1;
+		stack->next[i] = (i + 1 < size) ? i + 1 : -1;
 	}
+	stack->mru = 0;
+	stack->lru = size - 1;
 
-    ////////////////////////////////////////////////////////////////////
-    //  TODO: Write any other code needed to initialize your LRU Stack.
-    //  Essentially write any initializations needed for anything you
-    //  added to lru_stack_t.
-    ////////////////////////////////////////////////////////////////////
-
-    ////////////////////////////////////////////////////////////////////
-    //  End of your code
-    ////////////////////////////////////////////////////////////////////
+	return stack;
+}
 
+lru_stack_t* lru_stack_rebase(void* mem) {
+	lru_stack_t* stack = (lru_stack_t*) mem;
+	stack->prev = stack->links;
+	stack->next = stack->links + stack->size;
 	return stack;
 }
 
@@ -64,14 +75,7 @@ lru_stack_t* init_lru_stack(int size) {
  * @return the index of the LRU cache block.
  */
 int lru_stack_get_lru(lru_stack_t* stack) {
-    ////////////////////////////////////////////////////////////////////
-    //  TODO: Write code to get the index of the LRU block from the LRU
-    //  Stack.
-    ////////////////////////////////////////////////////////////////////
-    return stack->values[stack->size-1];
-    ////////////////////////////////////////////////////////////////////
-    //  End of your code
-    ////////////////////////////////////////////////////////////////////
+    return stack->lru;
 }
 
 /**
@@ -82,36 +86,29 @@ int lru_stack_get_lru(lru_stack_t* stack) {
  * @param n the index to promote to MRU.
  */
 void lru_stack_set_mru(lru_stack_t* stack, int n) {
-	////////////////////////////////////////////////////////////////////
-    //  TODO: Write code to set the passed in block index  as the MRU
-    //  element in the LRU Stack.
-    ////////////////////////////////////////////////////////////////////
-		int num=n;
-		int temp;
-		int iterator=0;
-		while (iterator<stack->size){
-			if (stack->values[iterator]==num)
-			{
-				break;
-			}
-			iterator+=1;
-		}
+	if (stack->mru == n) return;
 
-		//printf("iterator value=%d\n",iterator);
-		for (int i=0; i<=iterator;i++){
-			temp=stack->values[i];
-			stack->values[i]=num;
-			num=temp;
-		}
+	int* prev = stack->prev;
+	int* next = stack->next;
+
+	// Unlink n. It is not the MRU, so it has a predecessor.
+	next[prev[n]] = next[n];
+	if (next[n] >= 0) {
+		prev[next[n]] = prev[n];
+	} else {
+		stack->lru = prev[n];
+	}
 
-    ////////////////////////////////////////////////////////////////////
-    //  End of your code
-    ////////////////////////////////////////////////////////////////////
+	// Relink it in front of the old MRU
+	prev[n] = -1;
+	next[n] = stack->mru;
+	prev[stack->mru] = n;
+	stack->mru = n;
 }
 
 void lru_stack_print_list(lru_stack_t* stack){
-	for (int i=0; i<stack->size;i++){
-		printf("%d ",stack->values[i]);
+	for (int i = stack->mru; i >= 0; i = stack->next[i]){
+		printf("%d ", i);
 	}
 	printf("\n");
 }
@@ -121,14 +118,44 @@ void lru_stack_print_list(lru_stack_t* stack){
  * @param stack the stack to free
  */
 void lru_stack_cleanup(lru_stack_t* stack) {
-    ////////////////////////////////////////////////////////////////////
-    //  TODO: Write any code if you need to do additional heap allocation
-    //  cleanup
-    ////////////////////////////////////////////////////////////////////
-
-    ////////////////////////////////////////////////////////////////////
-    //  End of your code
-    ////////////////////////////////////////////////////////////////////
-		free(stack->values);
-    free(stack);        // Free the stack struct we malloc'd
+    free(stack);        // Free the stack struct we malloc'd, links included
+}
+
+lru_dist_stack_t* init_lru_dist_stack(int size) {
+	lru_dist_stack_t* stack = (lru_dist_stack_t*) malloc(sizeof(lru_dist_stack_t));
+	stack->size = size;
+	stack->depth = 0;
+	stack->keys = (unsigned long long*) malloc(sizeof(unsigned long long) * size);
+	return stack;
+}
+
+int lru_dist_stack_access(lru_dist_stack_t* stack, unsigned long long key) {
+	unsigned long long* keys = stack->keys;
+	int found = -1;
+	int pos;
+
+	for (pos = 0; pos < stack->depth; pos++) {
+		if (keys[pos] == key) {
+			found = pos;
+			break;
+		}
+	}
+
+	if (found < 0) {
+		// Not found: push onto the stack, dropping the LRU key if it is full
+		if (stack->depth < stack->size) {
+			stack->depth++;
+		}
+		pos = stack->depth - 1;
+	}
+
+	// Shift everything above <pos> down one and put the key on top
+	memmove(keys + 1, keys, sizeof(unsigned long long) * pos);
+	keys[0] = key;
+	return found;
+}
+
+void lru_dist_stack_cleanup(lru_dist_stack_t* stack) {
+	free(stack->keys);
+	free(stack);
 }
@@ -5,6 +5,8 @@
 #ifndef __LRUSTACK_H
 #define __LRUSTACK_H
 
+#include <stddef.h>
+
 /**
  * This file contains some starter code to get you started on your LRU implementation.
  * You are free to implement it however you see fit. You can design it to emulate how this
@@ -29,11 +31,19 @@
  * sure you understand that this is NOT written to store whole cache blocks. If you
  * want to do the latter, you will have to change the LRU interface defined in this
  * file.
+ *
+ * The stack is an intrusive doubly linked list over the block indices, from the MRU
+ * block along next[] to the LRU block: prev[i] is the block used just after block i
+ * and next[i] the block used just before it, with -1 past either end. Promoting a block to MRU only relinks it, so both operations are O(1) no matter
+ * how many ways the set has. The links live in the same allocation as the struct.
  */
 typedef struct lru_stack_t {
 	int size;   // Corresponds to the associativity
-	int *values;
-    // TODO: Add anything else needed to maintain a LRU Stack (ex: priority bits?).
+	int mru;    // Index of the most recently used block
+	int lru;    // Index of the least recently used block
+	int *prev;  // prev[i]: block used right after i (towards MRU), -1 if i is MRU
+	int *next;  // next[i]: block used right before i (towards LRU), -1 if i is LRU
+	int links[];
 } lru_stack_t;
 
 /**
@@ -45,6 +55,33 @@ typedef struct lru_stack_t {
  */
 lru_stack_t* init_lru_stack(int size);
 
+/**
+ * Function to get the number of bytes an LRU stack of <size> blocks needs.
+ *
+ * @param size is the size of the LRU stack.
+ * @return the size in bytes of the stack, links included.
+ */
+size_t lru_stack_bytes(int size);
+
+/**
+ * Function to initialize an LRU stack in memory the caller owns, e.g. as part of a larger
+ * per-set state block. Do not call lru_stack_cleanup on such a stack.
+ *
+ * @param mem is at least lru_stack_bytes(size) bytes, suitably aligned for an int.
+ * @param size is the size of the LRU stack to initialize.
+ * @return the stack, which starts at <mem>.
+ */
+lru_stack_t* init_lru_stack_at(void* mem, int size);
+
+/**
+ * Function to fix up an LRU stack whose bytes were copied to <mem> from another address,
+ * e.g. when restoring a checkpoint. The links themselves are indices and stay valid.
+ *
+ * @param mem holds the copied stack.
+ * @return the stack, which starts at <mem>.
+ */
+lru_stack_t* lru_stack_rebase(void* mem);
+
 /**
  * Function to get the index of the least recently used cache block, as indicated by <stack>.
  * This operation should not change/mutate your LRU stack.
@@ -70,4 +107,42 @@ void lru_stack_set_mru(lru_stack_t* stack, int n);
  */
 void lru_stack_cleanup(lru_stack_t* stack);
 
+/**
+ * A generalized LRU stack that holds arbitrary keys (e.g. line addresses) instead of
+ * block indices, and that reports how deep in the stack a key was found. This is what
+ * stack-distance analysis needs: a key found at depth d hits in every LRU cache set
+ * with more than d ways, so one stack answers the question for all associativities.
+ * Only the <size> most recent keys are kept; anything deeper counts as not found.
+ */
+typedef struct lru_dist_stack_t {
+	int size;					// Maximum depth tracked
+	int depth;					// Number of keys currently in the stack
+	unsigned long long *keys;	// keys[0] is the MRU key
+} lru_dist_stack_t;
+
+/**
+ * Function to initialize an empty distance stack tracking up to <size> keys.
+ *
+ * @param size is the maximum depth to track.
+ * @return the dynamically allocated stack.
+ */
+lru_dist_stack_t* init_lru_dist_stack(int size);
+
+/**
+ * Function to look up <key> in <stack> and make it the MRU key. If the stack is full and
+ * <key> was not found, the LRU key is dropped.
+ *
+ * @param stack is the stack to run the operation on.
+ * @param key is the key being accessed.
+ * @return the depth <key> was found at (0 for MRU), or -1 if it was not in the stack.
+ */
+int lru_dist_stack_access(lru_dist_stack_t* stack, unsigned long long key);
+
+/**
+ * Function to free up the memory allocated for <stack>
+ *
+ * @param stack the stack to free
+ */
+void lru_dist_stack_cleanup(lru_dist_stack_t* stack);
+
 #endif
@@ -0,0 +1,144 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+/**
+ * Microbenchmark for the LRU stack. It replays the same pseudo-random sequence of
+ * get LRU / set MRU operations through lrustack.c and through the original shifting
+ * array stack, checks that both pick the same LRU blocks, and reports ns per
+ * operation for associativities from 2 to 256.
+ *
+ * Build: gcc -std=gnu99 -O2 lrustackbench.c lrustack.c -o lrustackbench
+ * Usage: ./lrustackbench [operations per associativity]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lrustack.h"
+
+/**
+ * The original shifting stack: values[0] is the MRU block, values[size-1] the LRU
+ * block. Promoting a block searches for it and shifts everything above it down.
+ */
+typedef struct shift_stack_t {
+	int size;
+	int *values;
+} shift_stack_t;
+
+static shift_stack_t* init_shift_stack(int size) {
+	shift_stack_t* stack = (shift_stack_t*) malloc(sizeof(shift_stack_t));
+	stack->size = size;
+	stack->values = (int*) malloc(sizeof(int) * size);
+	for (int i = 0; i < size; i++) {
+		stack->values[i] = i;
+	}
+	return stack;
+}
+
+static int shift_stack_get_lru(shift_stack_t* stack) {
+	return stack->values[stack->size - 1];
+}
+
+static void shift_stack_set_mru(shift_stack_t* stack, int n) {
+	int num = n;
+	int temp;
+	int iterator = 0;
+	while (iterator < stack->size) {
+		if (stack->values[iterator] == num) break;
+		iterator++;
+	}
+	for (int i = 0; i <= iterator; i++) {
+		temp = stack->values[i];
+		stack->values[i] = num;
+		num = temp;
+	}
+}
+
+static void shift_stack_cleanup(shift_stack_t* stack) {
+	free(stack->values);
+	free(stack);
+}
+
+// An operation is either "promote block n" or, when negative, "promote the LRU block"
+#define OP_MISS -1
+
+/**
+ * Builds an access mix that looks like a cache: half the operations re-touch the
+ * block touched last (MRU hits), a third touch a random block, the rest are misses.
+ */
+static int* make_ops(int ways, long n) {
+	int* ops = (int*) malloc(sizeof(int) * n);
+	unsigned long long state = 0x9e3779b97f4a7c15ULL ^ (unsigned long long)ways;
+	int last = 0;
+	for (long i = 0; i < n; i++) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		unsigned int r = (unsigned int)(state >> 33);
+		unsigned int pick = r % 6;
+		if (pick < 3) {
+			ops[i] = last;
+		} else if (pick < 5) {
+			last = (int)((r / 6) % (unsigned int)ways);
+			ops[i] = last;
+		} else {
+			ops[i] = OP_MISS;
+		}
+	}
+	return ops;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+	long n = argc > 1 ? atol(argv[1]) : 10000000;
+	if (n <= 0) {
+		fprintf(stderr, "Usage: %s [operations per associativity]\n", argv[0]);
+		return 1;
+	}
+
+	printf("ways, list ns/op, shift ns/op, speedup\n");
+	for (int ways = 2; ways <= 256; ways *= 2) {
+		int* ops = make_ops(ways, n);
+
+		lru_stack_t* list = init_lru_stack(ways);
+		unsigned long long list_sum = 0;
+		double start = now();
+		for (long i = 0; i < n; i++) {
+			int way = ops[i];
+			if (way == OP_MISS) {
+				way = lru_stack_get_lru(list);
+				list_sum += way;
+			}
+			lru_stack_set_mru(list, way);
+		}
+		double list_time = now() - start;
+		lru_stack_cleanup(list);
+
+		shift_stack_t* shift = init_shift_stack(ways);
+		unsigned long long shift_sum = 0;
+		start = now();
+		for (long i = 0; i < n; i++) {
+			int way = ops[i];
+			if (way == OP_MISS) {
+				way = shift_stack_get_lru(shift);
+				shift_sum += way;
+			}
+			shift_stack_set_mru(shift, way);
+		}
+		double shift_time = now() - start;
+		shift_stack_cleanup(shift);
+		free(ops);
+
+		if (list_sum != shift_sum) {
+			fprintf(stderr, "%d ways: LRU choices differ between implementations\n", ways);
+			return 1;
+		}
+		printf("%d, %.2f, %.2f, %.2fx\n", ways, list_time * 1e9 / n, shift_time * 1e9 / n,
+		       shift_time / list_time);
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mrc.h"
+
+/**
+ * Per set-count state. There is one of these for every power-of-two number of sets
+ * from 1 up to the number of blocks in the largest cache.
+ */
+typedef struct mrc_level_t {
+	int num_sets;				// Number of sets at this level
+	int max_ways;				// Deepest stack distance anyone will ask about
+	lru_dist_stack_t** stacks;	// One distance stack per set
+	counter_t* hist;			// hist[d] = accesses found at stack depth d
+} mrc_level_t;
+
+static mrc_level_t* levels;
+static int num_levels;
+static int mrc_block_size;
+static int mrc_offset_bits;
+static int mrc_max_ways;
+static counter_t mrc_accesses;
+
+static int log_2(int x) {
+    int val = 0;
+    while (x > 1) {
+        x /= 2;
+        val++;
+    }
+    return val;
+}
+
+/**
+ * Function to initialize stack-distance mode.
+ *
+ * @param block_size is the block size in bytes
+ * @param max_cache_size is the largest cache size in bytes to report
+ * @param max_ways is the largest associativity to report
+ */
+void mrc_init(int block_size, int max_cache_size, int max_ways) {
+    int max_blocks = max_cache_size / block_size;
+    if (max_ways > max_blocks) max_ways = max_blocks;
+
+    mrc_block_size = block_size;
+    mrc_offset_bits = log_2(block_size);
+    mrc_max_ways = max_ways;
+    mrc_accesses = 0;
+
+    num_levels = log_2(max_blocks) + 1;
+    levels = (mrc_level_t*)malloc(sizeof(mrc_level_t) * num_levels);
+    for (int l = 0; l < num_levels; l++) {
+        mrc_level_t* level = &levels[l];
+        level->num_sets = 1 << l;
+        level->max_ways = max_blocks / level->num_sets;
+        if (level->max_ways > max_ways) level->max_ways = max_ways;
+        level->stacks = (lru_dist_stack_t**)malloc(sizeof(lru_dist_stack_t*) * level->num_sets);
+        for (int i = 0; i < level->num_sets; i++) {
+            level->stacks[i] = init_lru_dist_stack(level->max_ways);
+        }
+        level->hist = (counter_t*)calloc(level->max_ways, sizeof(counter_t));
+    }
+}
+
+/**
+ * Function to feed a single memory access to every set-count level.
+ *
+ * @param physical_addr is the address to use for the memory access.
+ * @param access_type is the type of access. Stack distances do not depend on it.
+ */
+void mrc_access(addr_t physical_addr, int access_type) {
+    (void)access_type;
+    mrc_accesses++;
+
+    addr_t line_addr = physical_addr >> mrc_offset_bits;
+    for (int l = 0; l < num_levels; l++) {
+        mrc_level_t* level = &levels[l];
+        lru_dist_stack_t* stack = level->stacks[line_addr & (level->num_sets - 1)];
+        int depth = lru_dist_stack_access(stack, line_addr);
+        if (depth >= 0) level->hist[depth]++;
+    }
+}
+
+/**
+ * Function to print one "cache size, ways, accesses, hits, misses" line for every
+ * power-of-two cache size and associativity, smallest cache first.
+ */
+void mrc_print_stats(void) {
+    printf("cache_size, ways, accesses, hits, misses\n");
+    int max_blocks = 1 << (num_levels - 1);
+    for (int blocks = 1; blocks <= max_blocks; blocks *= 2) {
+        for (int ways = 1; ways <= blocks && ways <= mrc_max_ways; ways *= 2) {
+            mrc_level_t* level = &levels[log_2(blocks / ways)];
+            counter_t hits = 0;
+            for (int d = 0; d < ways; d++) {
+                hits += level->hist[d];
+            }
+            printf("%llu, %d, %llu, %llu, %llu\n",
+                   (counter_t)blocks * mrc_block_size, ways,
+                   mrc_accesses, hits, mrc_accesses - hits);
+        }
+    }
+}
+
+/**
+ * Function to free everything allocated by mrc_init.
+ */
+void mrc_cleanup(void) {
+    for (int l = 0; l < num_levels; l++) {
+        for (int i = 0; i < levels[l].num_sets; i++) {
+            lru_dist_stack_cleanup(levels[l].stacks[i]);
+        }
+        free(levels[l].stacks);
+        free(levels[l].hist);
+    }
+    free(levels);
+}
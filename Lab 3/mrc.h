@@ -0,0 +1,25 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __MRC_H
+#define __MRC_H
+
+#include "cachesim.h"
+
+/**
+ * Single-pass miss-ratio curves via LRU stack distances.
+ *
+ * For a fixed block size, an LRU cache with S sets and W ways hits exactly when the
+ * accessed line is among the W most recently used lines of its set. So for every
+ * power-of-two set count S we keep one lru_dist_stack_t per set and histogram the depth
+ * each access is found at. One pass over the trace then yields hits and misses for
+ * every (cache size, ways) combination up to the given maximums.
+ */
+
+void mrc_init(int block_size, int max_cache_size, int max_ways);
+void mrc_access(addr_t physical_addr, int access_type);
+void mrc_print_stats(void);
+void mrc_cleanup(void);
+
+#endif
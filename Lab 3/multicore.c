@@ -0,0 +1,1030 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "multicore.h"
+
+#define DEFAULT_QUANTUM 1000
+#define MAX_FIELDS 5
+#define HOT_LINES 10
+#define INITIAL_HOT_LINES 32
+#define INITIAL_QUANTUM_LINES 1024
+
+// Coherence state of a line in one core
+#define STATE_I 0
+#define STATE_S 1
+#define STATE_E 2
+#define STATE_O 3
+#define STATE_M 4
+
+/**
+ * Coherence table entry, one per line held by some L1.
+ */
+typedef struct dir_entry_t {
+	addr_t line;
+	unsigned long long sharers;	// Cores holding the line, the owner included
+	int owner;					// Core in E, O or M, -1 if none
+	int owner_state;			// STATE_E, STATE_O or STATE_M
+} dir_entry_t;
+
+/**
+ * An access the parallel phase simulated in a core's L1 that the serial phase still has
+ * to put through the coherence table: a miss, or a write hit that may need an upgrade.
+ */
+typedef struct mc_event_t {
+	unsigned long long seq;		// Global position of the access
+	addr_t addr;
+	addr_t victim;				// Block the miss evicted, if <evicted>
+	unsigned long long touched;	// Misses: words accessed in the line in the parallel phase
+	int is_write;
+	int missed;
+	int evicted;
+} mc_event_t;
+
+/**
+ * A write of a core in the current quantum.
+ */
+typedef struct mc_write_t {
+	addr_t line;
+	unsigned long long seq;		// Global position of the write
+} mc_write_t;
+
+typedef struct mc_core_t {
+	int id;
+	cache_t* l1;
+	const trace_record_t* records;
+	const unsigned long long* seqs;	// Global position of each record, NULL if implicit
+	size_t count;
+	size_t pos;					// First record of the current quantum
+	size_t end;					// First record after the current quantum
+	size_t next;				// First record the serial phase has yet to simulate
+	size_t records_size;		// Records of a quantum <written> and <events> have room for
+	mc_write_t* written;		// Writes of the quantum, grouped by shard
+	size_t shard_starts[MC_MAX_CORES + 1];	// First entry of each shard in <written>
+	mc_event_t* events;			// Events of the parallel phase, in order
+	size_t num_events;
+	size_t next_event;			// First event the serial phase has yet to replay
+	line_map_t filled;			// Line to the event of its latest fill in the parallel phase
+	unsigned long long* poison;	// Per L1 set: when another core writes a line it holds, or ~0
+	int* poisoned;				// Sets whose <poison> is not ~0
+	int num_poisoned;
+	addr_t* lost;				// Lines lost to invalidations, direct-mapped, 0 if empty
+	int lost_mask;
+	counter_t coherence_misses;
+	counter_t upgrades;
+	counter_t invalidations;	// Invalidations received
+} mc_core_t;
+
+/**
+ * The writes to one line in the current quantum.
+ */
+typedef struct mc_line_writes_t {
+	unsigned long long first;	// Global position of the first write
+	unsigned long long other;	// First write by a core other than <first_core>, ~0 if none
+	int first_core;
+} mc_line_writes_t;
+
+/**
+ * A line held by <core> since before the quantum that another core writes at <seq>.
+ */
+typedef struct mc_poison_t {
+	unsigned long long seq;
+	int set;					// L1 set of the line
+	int core;
+} mc_poison_t;
+
+/**
+ * The lines written in a quantum whose hash falls in one shard.
+ */
+typedef struct mc_shard_t {
+	line_map_t lines;			// Line to its entry in <writes>
+	mc_line_writes_t* writes;
+	size_t num_writes;
+	size_t writes_size;
+	mc_poison_t* poison;
+	size_t num_poison;
+	size_t poison_size;
+} mc_shard_t;
+
+struct multicore_t {
+	int num_cores;
+	int protocol;
+	int interconnect;
+	int quantum;
+	unsigned long long quantum_end;	// Global position after the current quantum
+	unsigned int quanta;			// Quanta begun so far
+	int threads;
+	int word_bytes;					// Granularity of false-sharing detection
+	mc_core_t cores[MC_MAX_CORES];
+	cache_t* l2;					// Shared L2, NULL if none
+	dir_entry_t* dir;				// Coherence table, one entry per L1 block
+	unsigned long long* touched;	// touched[slot * num_cores + core]: words accessed
+	line_map_t dir_map;				// Line to its coherence table slot
+	int* dir_free;					// Unused coherence table slots
+	int num_dir_free;
+	line_map_t hot;					// False-sharing invalidations per line
+	counter_t transactions;			// Misses and upgrades put on the bus or sent to the directory
+	counter_t messages;				// Snoops, or directory requests, forwards, invalidations and acks
+	counter_t invalidations;
+	counter_t false_sharing;
+	counter_t cache_to_cache;		// Misses served by another core's L1
+	counter_t memory_reads;
+	counter_t memory_writes;
+	// Threading
+	int done;
+	mc_shard_t shards[MC_MAX_CORES];	// One per thread
+	pthread_barrier_t start;
+	pthread_barrier_t written;		// Workers only: every core's written lines are grouped
+	pthread_barrier_t poisoned;		// Workers only: every shard's writes and poison are known
+	pthread_barrier_t finished;
+};
+
+static const char* protocol_names[] = { "mesi", "moesi" };
+static const char* interconnect_names[] = { "bus", "directory" };
+
+static inline unsigned int hash_line(addr_t line) {
+    return (unsigned int)((line * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+// The top bits of the hash, which line maps index by the bottom bits
+static inline int shard_of(const multicore_t* mc, addr_t line) {
+    return (int)(hash_line(line) >> 26) % mc->threads;
+}
+
+/*
+ * Coherence table. Every line held by an L1 has an entry, so the table never holds more
+ * entries than the L1s have blocks. Entries stay in their slot until the line leaves
+ * every L1.
+ */
+static int dir_find(const multicore_t* mc, addr_t line) {
+    return (int)line_map_find(&mc->dir_map, line);
+}
+
+static int dir_insert(multicore_t* mc, addr_t line) {
+    int slot = mc->dir_free[--mc->num_dir_free];
+    dir_entry_t* e = &mc->dir[slot];
+    e->line = line;
+    e->sharers = 0;
+    e->owner = -1;
+    e->owner_state = STATE_I;
+    memset(&mc->touched[(size_t)slot * mc->num_cores], 0,
+           sizeof(unsigned long long) * mc->num_cores);
+    line_map_insert(&mc->dir_map, line, slot);
+    return slot;
+}
+
+static void dir_remove(multicore_t* mc, int slot) {
+    line_map_remove(&mc->dir_map, mc->dir[slot].line, NULL);
+    mc->dir_free[mc->num_dir_free++] = slot;
+}
+
+static inline int core_state(const dir_entry_t* e, int core) {
+    if (!((e->sharers >> core) & 1)) return STATE_I;
+    return e->owner == core ? e->owner_state : STATE_S;
+}
+
+static inline unsigned long long word_bit(const multicore_t* mc, addr_t physical_addr) {
+    return 1ULL << (physical_addr % mc->cores[0].l1->block_size / mc->word_bytes);
+}
+
+static void count_false_sharing(multicore_t* mc, addr_t line) {
+    mc->false_sharing++;
+    long long count = line_map_find(&mc->hot, line);
+    line_map_insert(&mc->hot, line, count < 0 ? 1 : count + 1);
+}
+
+/**
+ * Function to read the block at <physical_addr> from the shared L2, or memory.
+ */
+static void shared_read(multicore_t* mc, addr_t physical_addr) {
+    cache_t* l2 = mc->l2;
+    if (!l2) {
+        mc->memory_reads++;
+        return;
+    }
+    l2->accesses++;
+    if (cache_probe(l2, physical_addr, MEMREAD)) {
+        l2->hits++;
+        return;
+    }
+    l2->misses++;
+    mc->memory_reads++;
+    addr_t victim;
+    if (cache_fill(l2, physical_addr, 0, &victim) == EVICT_DIRTY) {
+        l2->writebacks++;
+        mc->memory_writes++;
+    }
+}
+
+/**
+ * Function to write the dirty block at <physical_addr> back to the shared L2, or memory.
+ */
+static void shared_write_back(multicore_t* mc, addr_t physical_addr) {
+    cache_t* l2 = mc->l2;
+    if (!l2) {
+        mc->memory_writes++;
+        return;
+    }
+    addr_t victim;
+    if (!cache_mark_dirty(l2, physical_addr)
+        && cache_fill(l2, physical_addr, 1, &victim) == EVICT_DIRTY) {
+        l2->writebacks++;
+        mc->memory_writes++;
+    }
+}
+
+/**
+ * Function to invalidate the line of entry <slot> in every core but <core>, whose write
+ * to <bit> caused it.
+ */
+static void invalidate_others(multicore_t* mc, int slot, int core, addr_t physical_addr,
+                              unsigned long long bit) {
+    dir_entry_t* e = &mc->dir[slot];
+    addr_t line = e->line;
+    for (int j = 0; j < mc->num_cores; j++) {
+        if (j == core || !((e->sharers >> j) & 1)) continue;
+        mc_core_t* other = &mc->cores[j];
+        cache_invalidate(other->l1, physical_addr);
+        other->invalidations++;
+        other->lost[hash_line(line) & other->lost_mask] = line + 1;
+        mc->invalidations++;
+        if (mc->interconnect == INTERCONNECT_DIRECTORY) mc->messages += 2;
+        if (!(mc->touched[(size_t)slot * mc->num_cores + j] & bit)) {
+            count_false_sharing(mc, line);
+        }
+    }
+    e->sharers &= 1ULL << core;
+}
+
+/**
+ * Function to drop the line at <physical_addr> from <core>'s coherence state after its
+ * L1 evicted it, writing it back if the core owned it dirty.
+ */
+static void evict_line(multicore_t* mc, int core, addr_t physical_addr) {
+    int slot = dir_find(mc, physical_addr / mc->cores[0].l1->block_size);
+    dir_entry_t* e = &mc->dir[slot];
+    if (e->owner == core) {
+        if (e->owner_state == STATE_M || e->owner_state == STATE_O) {
+            shared_write_back(mc, physical_addr);
+            if (mc->interconnect == INTERCONNECT_DIRECTORY) mc->messages++;
+        }
+        e->owner = -1;
+    }
+    e->sharers &= ~(1ULL << core);
+    if (!e->sharers) dir_remove(mc, slot);
+}
+
+/**
+ * Function to count one coherence transaction that the owner of the line (if any) has
+ * to answer.
+ */
+static void count_transaction(multicore_t* mc, int forwarded) {
+    mc->transactions++;
+    if (mc->interconnect == INTERCONNECT_BUS) {
+        mc->messages += mc->num_cores - 1;
+    } else {
+        mc->messages += 1 + forwarded;
+    }
+}
+
+/**
+ * Function to perform a write hit of <core> on the line in coherence table slot <slot>:
+ * silently in E or M, otherwise as an upgrade that invalidates every other copy.
+ */
+static void coherent_write_hit(multicore_t* mc, mc_core_t* core, int slot, addr_t physical_addr,
+                               unsigned long long bit) {
+    dir_entry_t* e = &mc->dir[slot];
+    int state = core_state(e, core->id);
+    if (state == STATE_M) return;
+    if (state == STATE_E) {
+        e->owner_state = STATE_M;
+        return;
+    }
+    // Write to a line held in S or O: invalidate every other copy and take ownership
+    core->upgrades++;
+    count_transaction(mc, 0);
+    invalidate_others(mc, slot, core->id, physical_addr, bit);
+    e->owner = core->id;
+    e->owner_state = STATE_M;
+}
+
+/**
+ * Function to bring the line at <physical_addr> into the coherence state of <core> after
+ * a miss its L1 has already filled.
+ *
+ * @param evicted is 1 if the fill evicted the block at <victim>.
+ * @return the coherence table slot of the line.
+ */
+static int coherent_fill(multicore_t* mc, mc_core_t* core, addr_t physical_addr, int is_write,
+                         int evicted, addr_t victim) {
+    addr_t line = physical_addr / core->l1->block_size;
+    unsigned long long bit = word_bit(mc, physical_addr);
+    addr_t* lost = &core->lost[hash_line(line) & core->lost_mask];
+    if (*lost == line + 1) {
+        core->coherence_misses++;
+        *lost = 0;
+    }
+
+    // Make room first: evicting may reshuffle the coherence table
+    if (evicted) evict_line(mc, core->id, victim);
+    int slot = dir_find(mc, line);
+    if (slot < 0) slot = dir_insert(mc, line);
+    dir_entry_t* e = &mc->dir[slot];
+
+    count_transaction(mc, e->owner >= 0);
+    if (e->owner >= 0) {
+        // The owner answers with the data
+        mc->cache_to_cache++;
+        if (mc->interconnect == INTERCONNECT_DIRECTORY) mc->messages++;
+    } else {
+        shared_read(mc, physical_addr);
+    }
+
+    if (is_write) {
+        invalidate_others(mc, slot, core->id, physical_addr, bit);
+        e->owner = core->id;
+        e->owner_state = STATE_M;
+    } else if (!e->sharers) {
+        e->owner = core->id;
+        e->owner_state = STATE_E;
+    } else if (e->owner >= 0) {
+        if (e->owner_state == STATE_E) {
+            e->owner = -1;
+        } else if (e->owner_state == STATE_M) {
+            if (mc->protocol == PROTOCOL_MOESI) {
+                e->owner_state = STATE_O;
+            } else {
+                // MESI has no shared dirty state, so the data goes back as well
+                shared_write_back(mc, physical_addr);
+                e->owner = -1;
+            }
+        }
+    }
+    e->sharers |= 1ULL << core->id;
+    mc->touched[(size_t)slot * mc->num_cores + core->id] = bit;
+    return slot;
+}
+
+/**
+ * Function to perform one access of <core> with full coherence.
+ */
+static void coherent_access(multicore_t* mc, mc_core_t* core, addr_t physical_addr,
+                            int access_type) {
+    cache_t* l1 = core->l1;
+    addr_t line = physical_addr / l1->block_size;
+    unsigned long long bit = word_bit(mc, physical_addr);
+    int is_write = access_type == MEMWRITE;
+    int slot = dir_find(mc, line);
+    int state = slot >= 0 ? core_state(&mc->dir[slot], core->id) : STATE_I;
+
+    l1->accesses++;
+    if (state != STATE_I) {
+        cache_probe(l1, physical_addr, MEMREAD);
+        l1->hits++;
+        mc->touched[(size_t)slot * mc->num_cores + core->id] |= bit;
+        if (is_write) coherent_write_hit(mc, core, slot, physical_addr, bit);
+        return;
+    }
+
+    l1->misses++;
+    addr_t victim;
+    int evicted = cache_fill(l1, physical_addr, 0, &victim) != EVICT_NONE;
+    coherent_fill(mc, core, physical_addr, is_write, evicted, victim);
+}
+
+/**
+ * @return the global position of record <i> of <core>: its index in a tagged trace, or
+ *      for one trace per core its index times the number of cores plus the core.
+ */
+static inline unsigned long long record_seq(const multicore_t* mc, const mc_core_t* core,
+                                            size_t i) {
+    return core->seqs ? core->seqs[i] : (unsigned long long)i * mc->num_cores + core->id;
+}
+
+/**
+ * @return the global position of the first write to <line> in the current quantum by a
+ *      core other than <core>, or ~0 if there is none.
+ */
+static inline unsigned long long first_write_by_others(const multicore_t* mc, addr_t line,
+                                                       int core) {
+    const mc_shard_t* shard = &mc->shards[shard_of(mc, line)];
+    long long w = line_map_find(&shard->lines, line);
+    if (w < 0) return ~0ULL;
+    const mc_line_writes_t* writes = &shard->writes[w];
+    return writes->first_core == core ? writes->other : writes->first;
+}
+
+/**
+ * Function to group the writes of <core> in the current quantum by shard.
+ */
+static void core_collect_writes(multicore_t* mc, mc_core_t* core) {
+    size_t* starts = core->shard_starts;
+    size_t block_size = core->l1->block_size;
+    memset(starts, 0, sizeof(size_t) * (mc->threads + 1));
+    for (size_t i = core->pos; i < core->end; i++) {
+        const trace_record_t* r = &core->records[i];
+        if (trace_record_type(r) == MEMWRITE) starts[shard_of(mc, r->addr / block_size) + 1]++;
+    }
+    size_t ends[MC_MAX_CORES];
+    for (int t = 0; t < mc->threads; t++) {
+        starts[t + 1] += starts[t];
+        ends[t] = starts[t];
+    }
+    for (size_t i = core->pos; i < core->end; i++) {
+        const trace_record_t* r = &core->records[i];
+        if (trace_record_type(r) != MEMWRITE) continue;
+        mc_write_t* w = &core->written[ends[shard_of(mc, r->addr / block_size)]++];
+        w->line = r->addr / block_size;
+        w->seq = record_seq(mc, core, i);
+    }
+}
+
+/**
+ * Function to find, for the lines of shard <t> written in the current quantum, when they
+ * are first written and by which cores, and which lines held by some core since before
+ * the quantum another core writes. Only reads the coherence table, so all shards can be
+ * collected at once.
+ */
+static void shard_collect(multicore_t* mc, int t) {
+    mc_shard_t* shard = &mc->shards[t];
+    if (shard->lines.used) line_map_clear(&shard->lines);
+    shard->num_writes = 0;
+    for (int c = 0; c < mc->num_cores; c++) {
+        const mc_core_t* core = &mc->cores[c];
+        for (size_t k = core->shard_starts[t]; k < core->shard_starts[t + 1]; k++) {
+            const mc_write_t* w = &core->written[k];
+            long long index = line_map_find(&shard->lines, w->line);
+            if (index < 0) {
+                if (shard->num_writes == shard->writes_size) {
+                    shard->writes_size = shard->writes_size ? 2 * shard->writes_size : 64;
+                    shard->writes = (mc_line_writes_t*)realloc(
+                        shard->writes, sizeof(mc_line_writes_t) * shard->writes_size);
+                }
+                index = (long long)shard->num_writes++;
+                line_map_insert(&shard->lines, w->line, index);
+                shard->writes[index].first = w->seq;
+                shard->writes[index].other = ~0ULL;
+                shard->writes[index].first_core = c;
+                continue;
+            }
+            mc_line_writes_t* writes = &shard->writes[index];
+            if (writes->first_core == c) continue;
+            if (w->seq < writes->first) {
+                writes->other = writes->first;
+                writes->first = w->seq;
+                writes->first_core = c;
+            } else if (w->seq < writes->other) {
+                writes->other = w->seq;
+            }
+        }
+    }
+
+    shard->num_poison = 0;
+    int num_sets = mc->cores[0].l1->num_sets;
+    const line_map_t* lines = &shard->lines;
+    for (size_t s = 0; s <= lines->mask; s++) {
+        if (!lines->keys[s]) continue;
+        addr_t line = lines->keys[s] - 1;
+        const mc_line_writes_t* writes = &shard->writes[lines->values[s]];
+        int slot = dir_find(mc, line);
+        if (slot < 0) continue;
+        for (int c = 0; c < mc->num_cores; c++) {
+            unsigned long long seq = writes->first_core == c ? writes->other : writes->first;
+            if (!((mc->dir[slot].sharers >> c) & 1) || seq == ~0ULL) continue;
+            if (shard->num_poison == shard->poison_size) {
+                shard->poison_size = shard->poison_size ? 2 * shard->poison_size : 64;
+                shard->poison = (mc_poison_t*)realloc(shard->poison,
+                                                      sizeof(mc_poison_t) * shard->poison_size);
+            }
+            mc_poison_t* p = &shard->poison[shard->num_poison++];
+            p->seq = seq;
+            p->set = (int)(line & (num_sets - 1));
+            p->core = c;
+        }
+    }
+}
+
+/**
+ * Function to note that from global position <seq> on, another core's write may take a
+ * line in <set> away from <core>.
+ */
+static inline void poison_set(mc_core_t* core, int set, unsigned long long seq) {
+    if (core->poison[set] == ~0ULL) core->poisoned[core->num_poisoned++] = set;
+    if (seq < core->poison[set]) core->poison[set] = seq;
+}
+
+/**
+ * Function to run the parallel phase of the current quantum for <core>, simulating its
+ * accesses in its L1 only and logging misses and write hits for the serial phase.
+ *
+ * The L1 changes only through the core's own accesses and through invalidations by other
+ * cores' writes. An invalidation empties one block, which changes the outcome of later
+ * accesses to that line and of later misses in its set, but not of hits on the other
+ * blocks of the set. So the core can run ahead of the other cores up to its first access
+ * to a line another core has written earlier in the quantum, or its first miss in a set
+ * holding a line another core has written since the core got it.
+ */
+static void core_private_phase(multicore_t* mc, mc_core_t* core) {
+    cache_t* l1 = core->l1;
+    for (int k = 0; k < core->num_poisoned; k++) {
+        core->poison[core->poisoned[k]] = ~0ULL;
+    }
+    core->num_poisoned = 0;
+    for (int t = 0; t < mc->threads; t++) {
+        const mc_shard_t* shard = &mc->shards[t];
+        for (size_t p = 0; p < shard->num_poison; p++) {
+            const mc_poison_t* poison = &shard->poison[p];
+            if (poison->core == core->id) poison_set(core, poison->set, poison->seq);
+        }
+    }
+    core->num_events = 0;
+    core->next_event = 0;
+    if (core->filled.used) line_map_clear(&core->filled);
+
+    size_t i;
+    for (i = core->pos; i < core->end; i++) {
+        const trace_record_t* r = &core->records[i];
+        addr_t line = r->addr / l1->block_size;
+        int set = (int)(line & (l1->num_sets - 1));
+        unsigned long long seq = record_seq(mc, core, i);
+        unsigned long long taken = first_write_by_others(mc, line, core->id);
+        if (taken < seq) break;
+        unsigned long long bit = word_bit(mc, r->addr);
+        int is_write = trace_record_type(r) == MEMWRITE;
+        mc_event_t* ev = &core->events[core->num_events];
+        // A miss leaves the L1 alone, so the serial phase can still simulate it
+        int hit = cache_probe(l1, r->addr, MEMREAD);
+        if (!hit && core->poison[set] < seq) break;
+        if (taken != ~0ULL) poison_set(core, set, taken);
+        l1->accesses++;
+        if (hit) {
+            l1->hits++;
+            // A line held since before the quantum keeps its coherence table slot
+            long long fill = line_map_find(&core->filled, line);
+            if (fill >= 0) {
+                core->events[fill].touched |= bit;
+            } else {
+                mc->touched[(size_t)dir_find(mc, line) * mc->num_cores + core->id] |= bit;
+            }
+            if (!is_write) continue;
+            ev->missed = 0;
+        } else {
+            l1->misses++;
+            ev->missed = 1;
+            ev->evicted = cache_fill(l1, r->addr, 0, &ev->victim) != EVICT_NONE;
+            ev->touched = bit;
+            line_map_insert(&core->filled, line, (long long)core->num_events);
+        }
+        ev->seq = seq;
+        ev->addr = r->addr;
+        ev->is_write = is_write;
+        core->num_events++;
+    }
+    core->next = i;
+}
+
+typedef struct mc_worker_t {
+	multicore_t* mc;
+	int id;
+	pthread_t thread;
+} mc_worker_t;
+
+/**
+ * Function to run thread <id>'s part of the parallel phase of the current quantum: its
+ * cores and its shard.
+ */
+static void parallel_phase(multicore_t* mc, int id) {
+    for (int c = id; c < mc->num_cores; c += mc->threads) {
+        core_collect_writes(mc, &mc->cores[c]);
+    }
+    pthread_barrier_wait(&mc->written);
+    shard_collect(mc, id);
+    pthread_barrier_wait(&mc->poisoned);
+    for (int c = id; c < mc->num_cores; c += mc->threads) {
+        core_private_phase(mc, &mc->cores[c]);
+    }
+}
+
+static void* mc_worker(void* arg) {
+    mc_worker_t* w = (mc_worker_t*)arg;
+    multicore_t* mc = w->mc;
+    for (;;) {
+        pthread_barrier_wait(&mc->start);
+        if (mc->done) break;
+        parallel_phase(mc, w->id);
+        pthread_barrier_wait(&mc->finished);
+    }
+    return NULL;
+}
+
+/**
+ * Function to replay event <ev> of <core>'s parallel phase in the coherence table and
+ * the shared L2.
+ */
+static void replay_event(multicore_t* mc, mc_core_t* core, const mc_event_t* ev) {
+    if (!ev->missed) {
+        int slot = dir_find(mc, ev->addr / core->l1->block_size);
+        coherent_write_hit(mc, core, slot, ev->addr, word_bit(mc, ev->addr));
+        return;
+    }
+    int slot = coherent_fill(mc, core, ev->addr, ev->is_write, ev->evicted, ev->victim);
+    mc->touched[(size_t)slot * mc->num_cores + core->id] = ev->touched;
+}
+
+/**
+ * @return the global position of the next access of <core> the serial phase has to
+ *      handle, or ~0 if there is none.
+ */
+static unsigned long long serial_next_seq(const multicore_t* mc, const mc_core_t* core) {
+    if (core->next_event < core->num_events) return core->events[core->next_event].seq;
+    if (core->next < core->end) return record_seq(mc, core, core->next);
+    return ~0ULL;
+}
+
+/**
+ * Function to restore the order of the min-heap <heap> of <n> cores, keyed by <seqs>,
+ * after the key of the core at index <i> grew.
+ */
+static void sift_down(int* heap, int n, const unsigned long long* seqs, int i) {
+    for (;;) {
+        int least = i;
+        for (int child = 2 * i + 1; child <= 2 * i + 2 && child < n; child++) {
+            if (seqs[heap[child]] < seqs[heap[least]]) least = child;
+        }
+        if (least == i) return;
+        int core = heap[i];
+        heap[i] = heap[least];
+        heap[least] = core;
+        i = least;
+    }
+}
+
+/**
+ * Function to run the serial phase of the current quantum in order of global position:
+ * replay the events of the parallel phase, and simulate every access after it. The cores
+ * are kept in a heap by the position of their next access.
+ */
+static void serial_phase(multicore_t* mc) {
+    int heap[MC_MAX_CORES];
+    unsigned long long seqs[MC_MAX_CORES];
+    int n = 0;
+    for (int c = 0; c < mc->num_cores; c++) {
+        seqs[c] = serial_next_seq(mc, &mc->cores[c]);
+        if (seqs[c] != ~0ULL) heap[n++] = c;
+    }
+    for (int i = n / 2 - 1; i >= 0; i--) {
+        sift_down(heap, n, seqs, i);
+    }
+
+    while (n > 0) {
+        mc_core_t* first = &mc->cores[heap[0]];
+        if (first->next_event < first->num_events) {
+            replay_event(mc, first, &first->events[first->next_event++]);
+        } else {
+            const trace_record_t* r = &first->records[first->next++];
+            coherent_access(mc, first, r->addr, trace_record_type(r));
+        }
+        seqs[first->id] = serial_next_seq(mc, first);
+        if (seqs[first->id] == ~0ULL) heap[0] = heap[--n];
+        sift_down(heap, n, seqs, 0);
+    }
+}
+
+/**
+ * Function to find the records of every core in the quantum ending at global position
+ * <quantum_end>, and make room for what the parallel phase keeps about them.
+ */
+static void begin_quantum(multicore_t* mc, unsigned long long quantum_end) {
+    mc->quantum_end = quantum_end;
+    mc->quanta++;
+    for (int c = 0; c < mc->num_cores; c++) {
+        mc_core_t* core = &mc->cores[c];
+        core->pos = core->end;
+        while (core->end < core->count && record_seq(mc, core, core->end) < quantum_end) {
+            core->end++;
+        }
+        size_t n = core->end - core->pos;
+        if (n > core->records_size) {
+            core->records_size = n;
+            core->written = (mc_write_t*)realloc(core->written, sizeof(mc_write_t) * n);
+            core->events = (mc_event_t*)realloc(core->events, sizeof(mc_event_t) * n);
+        }
+    }
+}
+
+void multicore_run(multicore_t* mc, const trace_record_t* const* records,
+                   const unsigned long long* const* seqs, const size_t* counts) {
+    for (int c = 0; c < mc->num_cores; c++) {
+        mc->cores[c].records = records[c];
+        mc->cores[c].seqs = seqs ? seqs[c] : NULL;
+        mc->cores[c].count = counts[c];
+        mc->cores[c].end = 0;
+    }
+
+    mc_worker_t workers[MC_MAX_CORES];
+    mc->done = 0;
+    pthread_barrier_init(&mc->start, NULL, mc->threads + 1);
+    pthread_barrier_init(&mc->written, NULL, mc->threads);
+    pthread_barrier_init(&mc->poisoned, NULL, mc->threads);
+    pthread_barrier_init(&mc->finished, NULL, mc->threads + 1);
+    // With one thread the main thread runs the parallel phase itself
+    for (int i = 0; mc->threads > 1 && i < mc->threads; i++) {
+        workers[i].mc = mc;
+        workers[i].id = i;
+        pthread_create(&workers[i].thread, NULL, mc_worker, &workers[i]);
+    }
+
+    // A quantum spans <quantum> accesses per core
+    unsigned long long span = (unsigned long long)mc->quantum * mc->num_cores;
+    for (unsigned long long quantum_end = span; ; quantum_end += span) {
+        int remaining = 0;
+        for (int c = 0; c < mc->num_cores; c++) {
+            remaining |= mc->cores[c].end < mc->cores[c].count;
+        }
+        if (!remaining) break;
+        begin_quantum(mc, quantum_end);
+        if (mc->threads > 1) {
+            pthread_barrier_wait(&mc->start);
+            pthread_barrier_wait(&mc->finished);
+        } else {
+            parallel_phase(mc, 0);
+        }
+        serial_phase(mc);
+    }
+
+    if (mc->threads > 1) {
+        mc->done = 1;
+        pthread_barrier_wait(&mc->start);
+        for (int i = 0; i < mc->threads; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+    }
+    pthread_barrier_destroy(&mc->start);
+    pthread_barrier_destroy(&mc->written);
+    pthread_barrier_destroy(&mc->poisoned);
+    pthread_barrier_destroy(&mc->finished);
+}
+
+static int is_power_of_two(long x) {
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+static int table_size(long n) {
+    int size = 1;
+    while (size < n) size *= 2;
+    return size;
+}
+
+/**
+ * Function to create a cache from the fields of an l1 or l2 description.
+ */
+static cache_t* parse_cache(char** fields, int n, const repl_policy_t* policy) {
+    if (n < 4) return NULL;
+    int block_size = atoi(fields[1]);
+    int cache_size = atoi(fields[2]);
+    int ways = atoi(fields[3]);
+    if (!is_power_of_two(block_size) || !is_power_of_two(cache_size) || !is_power_of_two(ways)
+        || (long)block_size * ways > cache_size) {
+        return NULL;
+    }
+    if (n > 4 && !(policy = repl_find(fields[4]))) return NULL;
+    return cache_create(block_size, cache_size, ways, policy);
+}
+
+/**
+ * Function to parse one item of a multicore description into <mc>.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int parse_item(multicore_t* mc, char* item, const repl_policy_t* policy,
+                      cache_t** l1s) {
+    char* fields[MAX_FIELDS];
+    int n = 0;
+    for (char* p = item; n < MAX_FIELDS; ) {
+        fields[n++] = p;
+        char* colon = strchr(p, ':');
+        if (!colon) break;
+        *colon = '\0';
+        p = colon + 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (n == 1 && strcmp(fields[0], protocol_names[i]) == 0) {
+            mc->protocol = i;
+            return 0;
+        }
+        if (n == 1 && strcmp(fields[0], interconnect_names[i]) == 0) {
+            mc->interconnect = i;
+            return 0;
+        }
+    }
+    if (strcmp(fields[0], "quantum") == 0) {
+        mc->quantum = n == 2 ? atoi(fields[1]) : 0;
+        return mc->quantum > 0 ? 0 : -1;
+    }
+    if (strcmp(fields[0], "l2") == 0 && !mc->l2) {
+        mc->l2 = parse_cache(fields, n, policy);
+        return mc->l2 ? 0 : -1;
+    }
+    if (strcmp(fields[0], "l1") == 0 && !l1s[0]) {
+        for (int c = 0; c < mc->num_cores; c++) {
+            char* copy[MAX_FIELDS];
+            memcpy(copy, fields, sizeof(copy));
+            if (!(l1s[c] = parse_cache(copy, n, policy))) return -1;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+multicore_t* multicore_create(const char* spec, int num_cores, const repl_policy_t* policy,
+                              int threads) {
+    if (num_cores < 1 || num_cores > MC_MAX_CORES) {
+        fprintf(stderr, "Between 1 and %d cores are supported\n", MC_MAX_CORES);
+        return NULL;
+    }
+    multicore_t* mc = (multicore_t*)calloc(1, sizeof(multicore_t));
+    mc->num_cores = num_cores;
+    mc->quantum = DEFAULT_QUANTUM;
+
+    cache_t* l1s[MC_MAX_CORES] = { NULL };
+    char* buf = strdup(spec);
+    char* save;
+    int ok = 1;
+    for (char* item = strtok_r(buf, ",", &save); item && ok; item = strtok_r(NULL, ",", &save)) {
+        char copy[256];
+        snprintf(copy, sizeof(copy), "%s", item);
+        if (parse_item(mc, item, policy, l1s) < 0) {
+            fprintf(stderr, "Invalid multicore item: %s\n", copy);
+            ok = 0;
+        }
+    }
+    free(buf);
+    for (int c = 0; c < num_cores; c++) {
+        mc->cores[c].l1 = l1s[c];
+    }
+    if (ok && !l1s[0]) {
+        fprintf(stderr, "A multicore description needs an l1\n");
+        ok = 0;
+    }
+    if (ok && mc->l2 && mc->l2->block_size != l1s[0]->block_size) {
+        fprintf(stderr, "The l1 and l2 must use the same block size\n");
+        ok = 0;
+    }
+    if (!ok) {
+        multicore_free(mc);
+        return NULL;
+    }
+
+    int block_size = l1s[0]->block_size;
+    mc->word_bytes = block_size / 64 > 8 ? block_size / 64 : 8;
+    if (mc->word_bytes > block_size) mc->word_bytes = block_size;
+    int dir_size = num_cores * l1s[0]->num_blocks;
+    mc->dir = (dir_entry_t*)calloc(dir_size, sizeof(dir_entry_t));
+    mc->touched = (unsigned long long*)calloc((size_t)dir_size * num_cores,
+                                              sizeof(unsigned long long));
+    line_map_init(&mc->dir_map, dir_size, 1);
+    mc->dir_free = (int*)malloc(sizeof(int) * dir_size);
+    for (int i = 0; i < dir_size; i++) mc->dir_free[i] = dir_size - 1 - i;
+    mc->num_dir_free = dir_size;
+    line_map_init(&mc->hot, INITIAL_HOT_LINES, 1);
+    int lost_size = table_size(4L * l1s[0]->num_blocks);
+    for (int c = 0; c < num_cores; c++) {
+        mc_core_t* core = &mc->cores[c];
+        core->id = c;
+        core->lost = (addr_t*)calloc(lost_size, sizeof(addr_t));
+        core->lost_mask = lost_size - 1;
+        line_map_init(&core->filled, INITIAL_QUANTUM_LINES, 1);
+        core->poison = (unsigned long long*)malloc(sizeof(unsigned long long)
+                                                   * l1s[0]->num_sets);
+        memset(core->poison, 0xff, sizeof(unsigned long long) * l1s[0]->num_sets);
+        core->poisoned = (int*)malloc(sizeof(int) * l1s[0]->num_sets);
+    }
+    mc->threads = threads < 1 ? 1 : threads > num_cores ? num_cores : threads;
+    for (int t = 0; t < mc->threads; t++) {
+        line_map_init(&mc->shards[t].lines, INITIAL_QUANTUM_LINES, 1);
+    }
+    return mc;
+}
+
+void multicore_print_stats(const multicore_t* mc, FILE* out) {
+    fprintf(out, "core, accesses, hits, misses, coherence_misses, upgrades, invalidations\n");
+    for (int c = 0; c < mc->num_cores; c++) {
+        const mc_core_t* core = &mc->cores[c];
+        fprintf(out, "%d, %llu, %llu, %llu, %llu, %llu, %llu\n", c, core->l1->accesses,
+                core->l1->hits, core->l1->misses, core->coherence_misses, core->upgrades,
+                core->invalidations);
+    }
+    if (mc->l2) {
+        fprintf(out, "l2_accesses, l2_hits, l2_misses, l2_writebacks\n");
+        fprintf(out, "%llu, %llu, %llu, %llu\n", mc->l2->accesses, mc->l2->hits,
+                mc->l2->misses, mc->l2->writebacks);
+    }
+    fprintf(out, "protocol, interconnect, transactions, messages, invalidations,"
+                 " false_sharing, cache_to_cache, memory_reads, memory_writes\n");
+    fprintf(out, "%s, %s, %llu, %llu, %llu, %llu, %llu, %llu, %llu\n",
+            protocol_names[mc->protocol], interconnect_names[mc->interconnect],
+            mc->transactions, mc->messages, mc->invalidations, mc->false_sharing,
+            mc->cache_to_cache, mc->memory_reads, mc->memory_writes);
+
+    // The HOT_LINES lines with the most false-sharing invalidations, ties to the lower line
+    fprintf(out, "false_sharing_line, invalidations\n");
+    int picked[HOT_LINES];
+    int num_picked = 0;
+    while (num_picked < HOT_LINES) {
+        int best = -1;
+        const line_map_t* hot = &mc->hot;
+        for (int i = 0; i <= (int)hot->mask; i++) {
+            if (!hot->keys[i]) continue;
+            int taken = 0;
+            for (int j = 0; j < num_picked; j++) taken |= picked[j] == i;
+            if (taken) continue;
+            if (best < 0 || hot->values[i] > hot->values[best]
+                || (hot->values[i] == hot->values[best] && hot->keys[i] < hot->keys[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) break;
+        picked[num_picked++] = best;
+        fprintf(out, "0x%llx, %lld\n", (hot->keys[best] - 1) * mc->cores[0].l1->block_size,
+                hot->values[best]);
+    }
+}
+
+void multicore_free(multicore_t* mc) {
+    if (!mc) return;
+    for (int c = 0; c < mc->num_cores; c++) {
+        if (mc->cores[c].l1) cache_free(mc->cores[c].l1);
+        free(mc->cores[c].lost);
+        free(mc->cores[c].written);
+        free(mc->cores[c].events);
+        free(mc->cores[c].poison);
+        free(mc->cores[c].poisoned);
+        line_map_free(&mc->cores[c].filled);
+    }
+    for (int t = 0; t < mc->threads; t++) {
+        line_map_free(&mc->shards[t].lines);
+        free(mc->shards[t].writes);
+        free(mc->shards[t].poison);
+    }
+    if (mc->l2) cache_free(mc->l2);
+    free(mc->dir);
+    free(mc->touched);
+    line_map_free(&mc->dir_map);
+    free(mc->dir_free);
+    line_map_free(&mc->hot);
+    free(mc);
+}
+
+int multicore_load_tagged_trace(const char* filename, trace_record_t** records,
+                                unsigned long long** seqs, size_t* counts) {
+    // Read through zlib so the trace may be gzip compressed
+    gzFile file = strcmp(filename, "-") == 0 ? gzdopen(dup(STDIN_FILENO), "rb")
+                                             : gzopen(filename, "rb");
+    if (!file) return -1;
+    size_t caps[MC_MAX_CORES] = { 0 };
+    for (int c = 0; c < MC_MAX_CORES; c++) {
+        records[c] = NULL;
+        seqs[c] = NULL;
+        counts[c] = 0;
+    }
+
+    int num_cores = 0;
+    unsigned long long seq = 0;
+    char line[256];
+    while (gzgets(file, line, sizeof(line))) {
+        int t, core;
+        unsigned long long address, instr;
+        int fields = sscanf(line, "%d %llx %llx %d", &t, &address, &instr, &core);
+        if (fields <= 0) continue;
+        if (fields != 4 || core < 0 || core >= MC_MAX_CORES) {
+            gzclose(file);
+            return -1;
+        }
+        if (counts[core] == caps[core]) {
+            caps[core] = caps[core] ? caps[core] * 2 : 4096;
+            records[core] = (trace_record_t*)realloc(records[core],
+                                                     sizeof(trace_record_t) * caps[core]);
+            seqs[core] = (unsigned long long*)realloc(seqs[core],
+                                                      sizeof(unsigned long long) * caps[core]);
+        }
+        records[core][counts[core]] = trace_record_make(t, address, instr);
+        seqs[core][counts[core]++] = seq++;
+        if (core >= num_cores) num_cores = core + 1;
+    }
+    // gzgets() stops on a decompression error as on the end of the trace
+    int err;
+    const char* msg = gzerror(file, &err);
+    if (err != Z_OK && err != Z_STREAM_END) {
+        fprintf(stderr, "%s\n", msg);
+        num_cores = -1;
+    }
+    gzclose(file);
+    return num_cores;
+}
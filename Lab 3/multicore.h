@@ -0,0 +1,102 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __MULTICORE_H
+#define __MULTICORE_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * Multi-core simulation. Each core has a private unified L1 kept coherent with MESI or
+ * MOESI, and the cores share an optional L2 in front of memory.
+ *
+ * Coherence state lives in a table indexed by line address with one entry per line
+ * held by any L1: the set of cores holding it, and the owner (the core in E, M or O
+ * state) if there is one. The other holders are in S. On a snooping bus every miss
+ * and upgrade is broadcast to the other cores; with a directory only the cores
+ * involved are sent messages. The two differ only in the messages counted.
+ *
+ * Accesses are simulated in trace order. A single trace with a core column keeps its
+ * own interleaving; with one trace per core, the cores take turns access by access.
+ * Cores run on threads in quanta of <quantum> accesses per core. An L1 changes only
+ * through its own core's accesses and through invalidations by other cores' writes, so
+ * each quantum first collects every core's writes. Then every core simulates its hits
+ * and misses in its own L1 in parallel, up to its first access to a line another core
+ * wrote earlier in the quantum, or its first miss in a set holding such a line. Misses
+ * and write hits are logged, and the L2 and coherence side of them is replayed one at a
+ * time in trace order together with the rest of the quantum. The results equal those
+ * of a serial run, whatever the quantum and the number of threads; with one core they
+ * equal those of a single cache.
+ *
+ * Reported per core: accesses, hits, misses, coherence misses (misses on a line this
+ * core lost to an invalidation), upgrades (writes to lines held in S or O) and
+ * invalidations received. Also reported: total bus or directory traffic, cache to
+ * cache transfers, and the lines with the most false-sharing invalidations, where the
+ * invalidating write did not touch any word the invalidated core had accessed.
+ */
+
+#define MC_MAX_CORES 64
+
+#define PROTOCOL_MESI 0
+#define PROTOCOL_MOESI 1
+
+#define INTERCONNECT_BUS 0
+#define INTERCONNECT_DIRECTORY 1
+
+typedef struct multicore_t multicore_t;
+
+/**
+ * Function to create a multi-core simulator from <spec>, a comma separated list of
+ *
+ *     l1:<block size>:<cache size>:<ways>[:<policy>]   private L1 of every core (required)
+ *     l2:<block size>:<cache size>:<ways>[:<policy>]   shared L2
+ *     mesi or moesi                                    protocol, default mesi
+ *     bus or directory                                 interconnect, default bus
+ *     quantum:<accesses>                               default 1000
+ *
+ * @param num_cores is the number of cores.
+ * @param policy is the policy of caches that do not name one.
+ * @param threads is the number of threads to simulate the cores with.
+ * @return the dynamically allocated simulator, or NULL (after printing why) if <spec>
+ *      is invalid.
+ */
+multicore_t* multicore_create(const char* spec, int num_cores, const repl_policy_t* policy,
+                              int threads);
+
+/**
+ * Function to simulate the traces of all cores. Core i runs <records[i]>, an array of
+ * <counts[i]> records.
+ *
+ * @param seqs is NULL if every core has its own trace. Otherwise <seqs[i]> gives the
+ *      position in the tagged trace of each record of core i, in increasing order.
+ */
+void multicore_run(multicore_t* mc, const trace_record_t* const* records,
+                   const unsigned long long* const* seqs, const size_t* counts);
+
+/**
+ * Function to print the per-core, shared cache, traffic and false-sharing statistics
+ * as CSV.
+ */
+void multicore_print_stats(const multicore_t* mc, FILE* out);
+
+/**
+ * Function to free the simulator and its caches.
+ */
+void multicore_free(multicore_t* mc);
+
+/**
+ * Function to read a text trace with a fourth column giving the core of each access
+ * into one record array per core. The trace may be gzip compressed, and "-" reads
+ * standard input.
+ *
+ * @param records is set to an array of MC_MAX_CORES dynamically allocated arrays.
+ * @param seqs is set likewise to the position in the trace of each record.
+ * @param counts is set to the number of records of each core.
+ * @return the number of cores (the highest core id plus one), or -1 on error.
+ */
+int multicore_load_tagged_trace(const char* filename, trace_record_t** records,
+                                unsigned long long** seqs, size_t* counts);
+
+#endif
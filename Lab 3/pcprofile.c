@@ -0,0 +1,144 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pcprofile.h"
+
+#define INITIAL_CAPACITY 1024
+
+/**
+ * Function to double the capacity of an exact profile. Its map grows by itself.
+ */
+static void grow(pc_profile_t* prof) {
+    prof->capacity *= 2;
+    prof->entries = (pc_entry_t*)realloc(prof->entries, sizeof(pc_entry_t) * prof->capacity);
+}
+
+/*
+ * Min-heap of entries on misses, for bounded profiles. The root is the entry a new PC
+ * takes over.
+ */
+static void heap_swap(pc_profile_t* prof, size_t i, size_t j) {
+    size_t a = prof->heap[i];
+    size_t b = prof->heap[j];
+    prof->heap[i] = b;
+    prof->heap[j] = a;
+    prof->heap_pos[b] = i;
+    prof->heap_pos[a] = j;
+}
+
+static inline counter_t heap_misses(const pc_profile_t* prof, size_t i) {
+    return prof->entries[prof->heap[i]].misses;
+}
+
+static void heap_sift_up(pc_profile_t* prof, size_t i) {
+    while (i > 0 && heap_misses(prof, (i - 1) / 2) > heap_misses(prof, i)) {
+        heap_swap(prof, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_sift_down(pc_profile_t* prof, size_t i) {
+    for (;;) {
+        size_t least = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < prof->used && heap_misses(prof, left) < heap_misses(prof, least)) least = left;
+        if (right < prof->used && heap_misses(prof, right) < heap_misses(prof, least)) least = right;
+        if (least == i) return;
+        heap_swap(prof, i, least);
+        i = least;
+    }
+}
+
+pc_profile_t* pc_profile_create(size_t capacity) {
+    pc_profile_t* prof = (pc_profile_t*)calloc(1, sizeof(pc_profile_t));
+    prof->bounded = capacity > 0;
+    prof->capacity = capacity ? capacity : INITIAL_CAPACITY;
+    prof->entries = (pc_entry_t*)malloc(sizeof(pc_entry_t) * prof->capacity);
+    line_map_init(&prof->map, prof->capacity, 1);
+    if (prof->bounded) {
+        prof->heap = (size_t*)malloc(sizeof(size_t) * capacity);
+        prof->heap_pos = (size_t*)malloc(sizeof(size_t) * capacity);
+    }
+    return prof;
+}
+
+void pc_profile_access(pc_profile_t* prof, addr_t pc, int result) {
+    int missed = result != ACCESS_HIT;
+    prof->accesses++;
+    prof->misses += missed;
+
+    long long found = line_map_find(&prof->map, pc);
+    size_t e;
+    if (found >= 0) {
+        e = (size_t)found;
+    } else if (prof->used < prof->capacity || !prof->bounded) {
+        if (prof->used == prof->capacity) grow(prof);
+        e = prof->used++;
+        memset(&prof->entries[e], 0, sizeof(pc_entry_t));
+        prof->entries[e].pc = pc;
+        line_map_insert(&prof->map, pc, e);
+        if (prof->bounded) {
+            prof->heap[e] = e;
+            prof->heap_pos[e] = e;
+            heap_sift_up(prof, e);
+        }
+    } else if (missed) {
+        // Take over the entry with the fewest misses
+        e = prof->heap[0];
+        pc_entry_t* entry = &prof->entries[e];
+        line_map_remove(&prof->map, entry->pc, NULL);
+        line_map_insert(&prof->map, pc, e);
+        entry->pc = pc;
+        entry->accesses = 0;
+        entry->writebacks = 0;
+        entry->error = entry->misses;
+    } else {
+        return;
+    }
+
+    pc_entry_t* entry = &prof->entries[e];
+    entry->accesses++;
+    if (!missed) return;
+    entry->misses++;
+    entry->writebacks += result == ACCESS_WRITEBACK;
+    if (prof->bounded) heap_sift_down(prof, prof->heap_pos[e]);
+}
+
+static int compare_misses(const void* a, const void* b) {
+    const pc_entry_t* x = (const pc_entry_t*)a;
+    const pc_entry_t* y = (const pc_entry_t*)b;
+    if (x->misses != y->misses) return x->misses < y->misses ? 1 : -1;
+    if (x->pc != y->pc) return x->pc < y->pc ? -1 : 1;
+    return 0;
+}
+
+void pc_profile_print(const pc_profile_t* prof, size_t top, FILE* out) {
+    pc_entry_t* sorted = (pc_entry_t*)malloc(sizeof(pc_entry_t) * (prof->used ? prof->used : 1));
+    memcpy(sorted, prof->entries, sizeof(pc_entry_t) * prof->used);
+    qsort(sorted, prof->used, sizeof(pc_entry_t), compare_misses);
+    if (!top || top > prof->used) top = prof->used;
+
+    fprintf(out, "pc, accesses, misses, writebacks, miss_ratio, miss_share, miss_error\n");
+    for (size_t i = 0; i < top; i++) {
+        const pc_entry_t* e = &sorted[i];
+        fprintf(out, "%llx, %llu, %llu, %llu, %.4f, %.4f, %llu\n", e->pc, e->accesses,
+                e->misses, e->writebacks,
+                e->accesses ? (double)(e->misses - e->error) / e->accesses : 0.0,
+                prof->misses ? (double)e->misses / prof->misses : 0.0, e->error);
+    }
+    free(sorted);
+}
+
+void pc_profile_free(pc_profile_t* prof) {
+    if (!prof) return;
+    free(prof->entries);
+    line_map_free(&prof->map);
+    free(prof->heap);
+    free(prof->heap_pos);
+    free(prof);
+}
@@ -0,0 +1,72 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __PCPROFILE_H
+#define __PCPROFILE_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * Per-PC attribution. Every access is charged to the instruction address in its
+ * trace record, and the PCs are reported ordered by misses, most first.
+ *
+ * By default every PC gets an entry, in a table that grows as needed. With a bound of
+ * <capacity> entries the table is instead a Space-Saving sketch. Once it is full, a
+ * miss by an untracked PC takes over the entry with the fewest misses. The new PC
+ * inherits that entry's miss count as an overestimate, recorded as its miss error.
+ * Any PC with more than total misses / <capacity> misses is guaranteed an entry.
+ * Tracked PCs' misses are overestimated by at most their miss error. Their accesses
+ * and writebacks are counted from when they took their entry, so those are
+ * underestimates. Hits by untracked PCs are not counted against any entry.
+ */
+
+typedef struct pc_entry_t {
+	addr_t pc;				// Instruction address
+	counter_t accesses;		// Accesses made by this PC
+	counter_t misses;		// Misses, including the inherited miss error
+	counter_t writebacks;	// Writebacks caused by this PC's misses
+	counter_t error;		// Misses inherited from the entry's previous PC
+} pc_entry_t;
+
+typedef struct pc_profile_t {
+	int bounded;			// 1 for a Space-Saving sketch, 0 for an exact table
+	size_t capacity;		// Entries allocated; the bound if bounded
+	size_t used;			// Entries in use
+	pc_entry_t* entries;	// The entries, in order of creation
+	line_map_t map;			// PC to entry
+	size_t* heap;			// Bounded only: entries as a min-heap on misses
+	size_t* heap_pos;		// Bounded only: position of each entry in the heap
+	counter_t accesses;		// All accesses seen, tracked or not
+	counter_t misses;		// All misses seen
+} pc_profile_t;
+
+/**
+ * Function to create a profile.
+ *
+ * @param capacity is the maximum number of entries, or 0 to track every PC exactly.
+ * @return the dynamically allocated profile.
+ */
+pc_profile_t* pc_profile_create(size_t capacity);
+
+/**
+ * Function to charge a SINGLE access to <pc>.
+ *
+ * @param result is the outcome of the access: ACCESS_HIT, ACCESS_MISS or
+ *      ACCESS_WRITEBACK.
+ */
+void pc_profile_access(pc_profile_t* prof, addr_t pc, int result);
+
+/**
+ * Function to print the <top> PCs with the most misses as CSV, or every PC if <top>
+ * is 0.
+ */
+void pc_profile_print(const pc_profile_t* prof, size_t top, FILE* out);
+
+/**
+ * Function to free <prof>.
+ */
+void pc_profile_free(pc_profile_t* prof);
+
+#endif
@@ -0,0 +1,382 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prefetch.h"
+
+#define DEFAULT_DEGREE 1
+#define DEFAULT_DISTANCE 1
+#define DEFAULT_LATENCY 16
+
+static inline unsigned int hash_line(addr_t line) {
+    return (unsigned int)((line * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+/**
+ * Function to take <line> out of the pending table. Every pending line is in the
+ * cache, so the table never holds more than the cache's block count.
+ *
+ * @return 1 and sets <issued_at> if <line> was pending, 0 otherwise.
+ */
+static int pending_take(prefetch_t* pf, addr_t line, counter_t* issued_at) {
+    long long at = 0;
+    if (!line_map_remove(&pf->pending, line, &at)) return 0;
+    *issued_at = (counter_t)at;
+    return 1;
+}
+
+/**
+ * Function to fill <line> into the cache and account for the block it evicts.
+ */
+static void fill(prefetch_t* pf, addr_t line, int dirty, int is_prefetch) {
+    cache_t* c = pf->cache;
+    addr_t victim;
+    int evicted = cache_fill(c, line * c->block_size, dirty, &victim);
+    if (evicted == EVICT_NONE) return;
+    if (evicted == EVICT_DIRTY) c->writebacks++;
+
+    addr_t victim_line = victim / c->block_size;
+    line_map_remove(&pf->pending, victim_line, NULL);
+    if (is_prefetch) {
+        pf->evicted[hash_line(victim_line) & pf->evicted_mask] = victim_line + 1;
+    }
+}
+
+static void count_useful(prefetch_t* pf, counter_t issued_at) {
+    pf->useful++;
+    if (pf->now - issued_at < (counter_t)pf->latency) pf->late++;
+}
+
+void prefetch_issue(prefetch_t* pf, addr_t line) {
+    if (cache_contains(pf->cache, line * pf->cache->block_size)) return;
+    pf->issued++;
+    fill(pf, line, 0, 1);
+    line_map_insert(&pf->pending, line, (long long)pf->now);
+}
+
+void prefetch_access(prefetch_t* pf, addr_t physical_addr, int access_type, addr_t pc) {
+    cache_t* c = pf->cache;
+    addr_t line = physical_addr / c->block_size;
+    const prefetcher_t* p = pf->prefetcher;
+    counter_t issued_at;
+    int trigger = 0;
+
+    pf->now++;
+    c->accesses++;
+    if (cache_probe(c, physical_addr, access_type)) {
+        c->hits++;
+        if (pending_take(pf, line, &issued_at)) {
+            count_useful(pf, issued_at);
+            trigger = 1;
+        }
+    } else if (p->buffer_take && p->buffer_take(pf->state, pf, line, &issued_at)) {
+        c->hits++;
+        count_useful(pf, issued_at);
+        fill(pf, line, access_type == MEMWRITE, 0);
+    } else {
+        c->misses++;
+        addr_t* evicted = &pf->evicted[hash_line(line) & pf->evicted_mask];
+        if (*evicted == line + 1) {
+            pf->pollution++;
+            *evicted = 0;
+        }
+        fill(pf, line, access_type == MEMWRITE, 0);
+        trigger = 1;
+    }
+    p->train(pf->state, pf, line, pc, trigger);
+}
+
+/*
+ * Next-line: fetch the blocks right after a miss, and keep going when a prefetched
+ * block is hit (tagged prefetching).
+ */
+static void* next_line_create(const prefetch_t* pf) {
+    (void)pf;
+    return NULL;
+}
+
+static void next_line_train(void* state, prefetch_t* pf, addr_t line, addr_t pc, int trigger) {
+    (void)state;
+    (void)pc;
+    if (!trigger) return;
+    for (int i = 0; i < pf->degree; i++) {
+        prefetch_issue(pf, line + pf->distance + i);
+    }
+}
+
+static void no_state_destroy(void* state) {
+    (void)state;
+}
+
+/*
+ * Stride: a direct-mapped reference prediction table indexed by PC. Each entry holds the
+ * last line the PC touched, the last stride and a 2-bit confidence counter; the stride
+ * is only replaced once confidence has dropped to zero.
+ */
+#define STRIDE_ENTRIES 256
+#define STRIDE_CONFIDENT 2
+#define STRIDE_MAX_CONFIDENCE 3
+
+typedef struct stride_entry_t {
+	addr_t pc;
+	addr_t last;		// Last line accessed by this PC
+	long long stride;	// In lines
+	int confidence;
+} stride_entry_t;
+
+static void* stride_create(const prefetch_t* pf) {
+    (void)pf;
+    return calloc(STRIDE_ENTRIES, sizeof(stride_entry_t));
+}
+
+static void stride_train(void* state, prefetch_t* pf, addr_t line, addr_t pc, int trigger) {
+    (void)trigger;
+    stride_entry_t* e = &((stride_entry_t*)state)[hash_line(pc) % STRIDE_ENTRIES];
+    if (e->pc != pc) {
+        e->pc = pc;
+        e->last = line;
+        e->stride = 0;
+        e->confidence = 0;
+        return;
+    }
+
+    long long delta = (long long)(line - e->last);
+    if (delta == 0) return;
+    e->last = line;
+    if (delta == e->stride) {
+        if (e->confidence < STRIDE_MAX_CONFIDENCE) e->confidence++;
+    } else if (e->confidence > 0) {
+        e->confidence--;
+    } else {
+        e->stride = delta;
+    }
+
+    if (e->confidence >= STRIDE_CONFIDENT) {
+        for (int i = 0; i < pf->degree; i++) {
+            prefetch_issue(pf, line + (addr_t)(e->stride * (pf->distance + i)));
+        }
+    }
+}
+
+static void free_state(void* state) {
+    free(state);
+}
+
+/*
+ * Stream buffers: STREAM_BUFFERS FIFOs of <degree> consecutive lines each. A demand miss
+ * that finds its line anywhere in a buffer takes it and everything before it, and the
+ * buffer is topped up from where it left off. Other misses reallocate the least
+ * recently used buffer.
+ */
+#define STREAM_BUFFERS 4
+
+typedef struct stream_buffer_t {
+	addr_t next;			// Next line to fetch into the buffer
+	int len;				// Lines in the buffer
+	counter_t last_used;	// For picking the buffer to reallocate
+	addr_t* lines;			// lines[0] is the head
+	counter_t* issued_at;
+} stream_buffer_t;
+
+typedef struct stream_state_t {
+	stream_buffer_t buffers[STREAM_BUFFERS];
+} stream_state_t;
+
+static void* stream_create(const prefetch_t* pf) {
+    stream_state_t* s = (stream_state_t*)calloc(1, sizeof(stream_state_t));
+    for (int i = 0; i < STREAM_BUFFERS; i++) {
+        s->buffers[i].lines = (addr_t*)malloc(sizeof(addr_t) * pf->degree);
+        s->buffers[i].issued_at = (counter_t*)malloc(sizeof(counter_t) * pf->degree);
+    }
+    return s;
+}
+
+static void stream_top_up(stream_buffer_t* b, prefetch_t* pf) {
+    while (b->len < pf->degree) {
+        b->lines[b->len] = b->next++;
+        b->issued_at[b->len] = pf->now;
+        b->len++;
+        pf->issued++;
+    }
+    b->last_used = pf->now;
+}
+
+static int stream_take(void* state, prefetch_t* pf, addr_t line, counter_t* issued_at) {
+    stream_state_t* s = (stream_state_t*)state;
+    for (int i = 0; i < STREAM_BUFFERS; i++) {
+        stream_buffer_t* b = &s->buffers[i];
+        for (int p = 0; p < b->len; p++) {
+            if (b->lines[p] != line) continue;
+            *issued_at = b->issued_at[p];
+            b->len -= p + 1;
+            memmove(b->lines, b->lines + p + 1, sizeof(addr_t) * b->len);
+            memmove(b->issued_at, b->issued_at + p + 1, sizeof(counter_t) * b->len);
+            stream_top_up(b, pf);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void stream_train(void* state, prefetch_t* pf, addr_t line, addr_t pc, int trigger) {
+    (void)pc;
+    if (!trigger) return;
+    stream_state_t* s = (stream_state_t*)state;
+    stream_buffer_t* b = &s->buffers[0];
+    for (int i = 1; i < STREAM_BUFFERS; i++) {
+        if (s->buffers[i].last_used < b->last_used) b = &s->buffers[i];
+    }
+    b->next = line + pf->distance;
+    b->len = 0;
+    stream_top_up(b, pf);
+}
+
+static void stream_destroy(void* state) {
+    stream_state_t* s = (stream_state_t*)state;
+    for (int i = 0; i < STREAM_BUFFERS; i++) {
+        free(s->buffers[i].lines);
+        free(s->buffers[i].issued_at);
+    }
+    free(s);
+}
+
+/*
+ * Delta correlation: each PC keeps its last DELTA_HISTORY miss deltas. When the latest
+ * pair of deltas occurred earlier in the history, the deltas that followed it then are
+ * assumed to follow it again and are replayed, repeating the matched stretch if it
+ * runs out.
+ */
+#define DELTA_ENTRIES 256
+#define DELTA_HISTORY 16
+
+typedef struct delta_entry_t {
+	addr_t pc;
+	addr_t last;						// Last line this PC missed on
+	int count;							// Deltas in history
+	long long deltas[DELTA_HISTORY];	// Oldest first
+} delta_entry_t;
+
+static void* delta_create(const prefetch_t* pf) {
+    (void)pf;
+    return calloc(DELTA_ENTRIES, sizeof(delta_entry_t));
+}
+
+static void delta_train(void* state, prefetch_t* pf, addr_t line, addr_t pc, int trigger) {
+    if (!trigger) return;
+    delta_entry_t* e = &((delta_entry_t*)state)[hash_line(pc) % DELTA_ENTRIES];
+    if (e->pc != pc) {
+        e->pc = pc;
+        e->last = line;
+        e->count = 0;
+        return;
+    }
+
+    long long delta = (long long)(line - e->last);
+    if (delta == 0) return;
+    e->last = line;
+    if (e->count == DELTA_HISTORY) {
+        memmove(e->deltas, e->deltas + 1, sizeof(long long) * (DELTA_HISTORY - 1));
+        e->count--;
+    }
+    e->deltas[e->count++] = delta;
+
+    int n = e->count;
+    if (n < 3) return;
+    int match = -1;
+    for (int j = n - 2; j >= 1; j--) {
+        if (e->deltas[j - 1] == e->deltas[n - 2] && e->deltas[j] == e->deltas[n - 1]) {
+            match = j;
+            break;
+        }
+    }
+    if (match < 0) return;
+
+    // Replay deltas[match + 1 .. n - 1] over and over, skipping the first distance - 1
+    addr_t target = line;
+    int k = match + 1;
+    for (int i = 0; i < pf->distance - 1 + pf->degree; i++) {
+        target += (addr_t)e->deltas[k];
+        if (++k == n) k = match + 1;
+        if (i >= pf->distance - 1) prefetch_issue(pf, target);
+    }
+}
+
+static const prefetcher_t prefetchers[] = {
+    { "next-line", next_line_create, next_line_train, NULL, no_state_destroy },
+    { "stride", stride_create, stride_train, NULL, free_state },
+    { "stream", stream_create, stream_train, stream_take, stream_destroy },
+    { "delta", delta_create, delta_train, NULL, free_state },
+};
+
+#define NUM_PREFETCHERS ((int)(sizeof(prefetchers) / sizeof(prefetchers[0])))
+
+const prefetcher_t* prefetch_find(const char* name) {
+    for (int i = 0; i < NUM_PREFETCHERS; i++) {
+        if (strcmp(prefetchers[i].name, name) == 0) return &prefetchers[i];
+    }
+    return NULL;
+}
+
+void prefetch_print_names(FILE* out, const char* sep) {
+    for (int i = 0; i < NUM_PREFETCHERS; i++) {
+        fprintf(out, "%s%s", i ? sep : "", prefetchers[i].name);
+    }
+}
+
+/**
+ * @return the smallest power of two that is at least <n>.
+ */
+static int table_size(int n) {
+    int size = 1;
+    while (size < n) size *= 2;
+    return size;
+}
+
+prefetch_t* prefetch_create(const char* spec, cache_t* c) {
+    char name[64];
+    size_t len = strcspn(spec, ":");
+    if (len >= sizeof(name)) return NULL;
+    memcpy(name, spec, len);
+    name[len] = '\0';
+    const prefetcher_t* prefetcher = prefetch_find(name);
+    if (!prefetcher) return NULL;
+
+    int values[3] = { DEFAULT_DEGREE, DEFAULT_DISTANCE, DEFAULT_LATENCY };
+    const char* p = spec + len;
+    for (int i = 0; i < 3 && *p == ':'; i++) {
+        char* end;
+        values[i] = (int)strtol(p + 1, &end, 10);
+        if (end == p + 1) return NULL;
+        p = end;
+    }
+    if (*p || values[0] < 1 || values[1] < 1 || values[2] < 0) return NULL;
+
+    prefetch_t* pf = (prefetch_t*)calloc(1, sizeof(prefetch_t));
+    pf->prefetcher = prefetcher;
+    pf->cache = c;
+    pf->degree = values[0];
+    pf->distance = values[1];
+    pf->latency = values[2];
+    line_map_init(&pf->pending, c->num_blocks, 1);
+    int evicted_size = table_size(c->num_blocks);
+    pf->evicted = (addr_t*)calloc(evicted_size, sizeof(addr_t));
+    pf->evicted_mask = evicted_size - 1;
+    pf->state = prefetcher->create(pf);
+    return pf;
+}
+
+void prefetch_print_stats(const prefetch_t* pf, FILE* out) {
+    fprintf(out, "prefetches, useful, late, pollution\n");
+    fprintf(out, "%llu, %llu, %llu, %llu\n", pf->issued, pf->useful, pf->late, pf->pollution);
+}
+
+void prefetch_free(prefetch_t* pf) {
+    if (!pf) return;
+    pf->prefetcher->destroy(pf->state);
+    line_map_free(&pf->pending);
+    free(pf->evicted);
+    free(pf);
+}
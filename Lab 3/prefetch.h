@@ -0,0 +1,113 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __PREFETCH_H
+#define __PREFETCH_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * Hardware prefetchers. A prefetch_t wraps a cache_t: demand accesses go through
+ * prefetch_access, which trains the prefetcher, and the prefetcher's requests are
+ * filled into the cache as clean blocks (or, for stream buffers, held in the
+ * prefetcher's own buffers until a demand miss asks for them).
+ *
+ * Available prefetchers:
+ *  - next-line: on a miss, or the first hit on a prefetched block, fetch the next
+ *               <degree> blocks starting <distance> blocks ahead
+ *  - stride:    a PC-indexed reference prediction table; once a load has repeated a
+ *               stride, fetch <degree> strides starting <distance> strides ahead
+ *  - stream:    Jouppi-style stream buffers; a miss allocates a buffer holding the
+ *               next <degree> blocks starting <distance> blocks ahead, and a miss
+ *               that finds its block in a buffer takes it from there
+ *  - delta:     delta correlation on each PC's recent miss deltas; when the last two
+ *               deltas were seen before, replay the deltas that followed them
+ *
+ * Statistics, alongside the cache's own:
+ *  - issued:    blocks fetched by the prefetcher
+ *  - useful:    prefetched blocks later hit by a demand access
+ *  - late:      useful prefetches whose demand hit came less than <latency> accesses
+ *               after the prefetch was issued, i.e. before the data would have arrived
+ *  - pollution: demand misses on blocks that a prefetch had evicted
+ */
+
+typedef struct prefetch_t prefetch_t;
+
+typedef struct prefetcher_t {
+	const char* name;
+	void* (*create)(const prefetch_t* pf);
+	// Called after every demand access. <trigger> is 1 for a miss or the first hit
+	// on a prefetched block. Requests are made with prefetch_issue.
+	void (*train)(void* state, prefetch_t* pf, addr_t line, addr_t pc, int trigger);
+	// Prefetchers with their own buffers only: takes <line> out of the buffers on a
+	// demand miss. Returns 1 and sets <issued_at> if the line was there.
+	int (*buffer_take)(void* state, prefetch_t* pf, addr_t line, counter_t* issued_at);
+	void (*destroy)(void* state);
+} prefetcher_t;
+
+struct prefetch_t {
+	const prefetcher_t* prefetcher;
+	void* state;			// The prefetcher's private state
+	cache_t* cache;			// The cache being prefetched into
+	int degree;				// Blocks fetched per trigger
+	int distance;			// How far ahead the first block is
+	int latency;			// Accesses a prefetch takes to arrive, for lateness
+	counter_t now;			// Demand accesses so far
+	line_map_t pending;		// Prefetched lines not yet used, to when each was issued
+	addr_t* evicted;		// Lines evicted by prefetches, direct-mapped, 0 if empty
+	int evicted_mask;		// Evicted table size - 1
+	counter_t issued;		// Blocks fetched by the prefetcher
+	counter_t useful;		// Prefetched blocks hit by a demand access
+	counter_t late;			// Useful prefetches that arrived after the demand access
+	counter_t pollution;	// Demand misses on blocks evicted by a prefetch
+};
+
+/**
+ * Function to look up a prefetcher by name.
+ *
+ * @return the prefetcher, or NULL if there is no such prefetcher.
+ */
+const prefetcher_t* prefetch_find(const char* name);
+
+/**
+ * Function to print the names of all prefetchers, separated by <sep>.
+ */
+void prefetch_print_names(FILE* out, const char* sep);
+
+/**
+ * Function to parse a prefetcher description, <name>[:<degree>[:<distance>[:<latency>]]],
+ * and attach the prefetcher to <c>. Degree and distance default to 1, latency to 16.
+ *
+ * @return the dynamically allocated prefetch_t, or NULL if <spec> is invalid.
+ */
+prefetch_t* prefetch_create(const char* spec, cache_t* c);
+
+/**
+ * Function to perform a SINGLE demand access to the cache of <pf>, updating the
+ * cache's statistics, and train the prefetcher on it.
+ *
+ * @param physical_addr is the address to use for the memory access.
+ * @param access_type is the type of access (MEMREAD, MEMWRITE or IFETCH).
+ * @param pc is the address of the instruction making the access.
+ */
+void prefetch_access(prefetch_t* pf, addr_t physical_addr, int access_type, addr_t pc);
+
+/**
+ * Function for prefetchers to request the block at line address <line> (the address
+ * divided by the block size). Blocks already in the cache are not fetched again.
+ */
+void prefetch_issue(prefetch_t* pf, addr_t line);
+
+/**
+ * Function to print the prefetch statistics as a CSV header and line.
+ */
+void prefetch_print_stats(const prefetch_t* pf, FILE* out);
+
+/**
+ * Function to free <pf>. The cache is left alone.
+ */
+void prefetch_free(prefetch_t* pf);
+
+#endif
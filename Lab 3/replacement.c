@@ -0,0 +1,435 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replacement.h"
+#include "lrustack.h"
+
+typedef unsigned long long word_t;
+
+#define WORD_BITS 64
+
+static inline int get_bit(const word_t* bits, int i) {
+    return (int)((bits[i / WORD_BITS] >> (i % WORD_BITS)) & 1);
+}
+
+static inline void put_bit(word_t* bits, int i, int v) {
+    word_t mask = 1ULL << (i % WORD_BITS);
+    if (v) {
+        bits[i / WORD_BITS] |= mask;
+    } else {
+        bits[i / WORD_BITS] &= ~mask;
+    }
+}
+
+static inline int bit_words(int ways) {
+    return (ways + WORD_BITS - 1) / WORD_BITS;
+}
+
+/**
+ * Small per-set generator (xorshift32) for the randomized policies. Keeping one per set
+ * instead of one per cache makes the choices independent of how sets interleave, so a
+ * set-sharded parallel run makes the same choices as a serial one.
+ */
+static inline unsigned int next_random(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static inline unsigned int random_seed(int set) {
+    return ((unsigned int)set * 0x9e3779b9u + 0x6d2b79f5u) | 1u;  // Never the stuck state 0
+}
+
+/*
+ * LRU: the LRU stack, stored in place.
+ */
+static size_t lru_state_size(int ways) {
+    return lru_stack_bytes(ways);
+}
+
+static void lru_init(repl_t* r, void* state, int set) {
+    (void)set;
+    init_lru_stack_at(state, r->ways);
+}
+
+static void lru_touch(repl_t* r, void* state, int set, int way) {
+    (void)r;
+    (void)set;
+    lru_stack_set_mru((lru_stack_t*)state, way);
+}
+
+static int lru_victim(repl_t* r, void* state, int set) {
+    (void)r;
+    (void)set;
+    return lru_stack_get_lru((lru_stack_t*)state);
+}
+
+static void lru_relocate(repl_t* r, void* state, int set) {
+    (void)r;
+    (void)set;
+    lru_stack_rebase(state);
+}
+
+/*
+ * Tree PLRU: a binary tree over the ways stored heap-style in bits 1..ways-1. Each node
+ * bit points to the half holding the victim (0 left, 1 right); touching a way flips the
+ * bits on its path to point away from it.
+ */
+static size_t tree_plru_state_size(int ways) {
+    return sizeof(word_t) * bit_words(ways);
+}
+
+static void tree_plru_init(repl_t* r, void* state, int set) {
+    (void)set;
+    memset(state, 0, tree_plru_state_size(r->ways));
+}
+
+static void tree_plru_touch(repl_t* r, void* state, int set, int way) {
+    (void)set;
+    word_t* bits = (word_t*)state;
+    for (int node = way + r->ways; node > 1; node >>= 1) {
+        put_bit(bits, node >> 1, !(node & 1));
+    }
+}
+
+static int tree_plru_victim(repl_t* r, void* state, int set) {
+    (void)set;
+    const word_t* bits = (const word_t*)state;
+    int node = 1;
+    while (node < r->ways) {
+        node = 2 * node + get_bit(bits, node);
+    }
+    return node - r->ways;
+}
+
+/*
+ * Bit PLRU: one MRU bit per way. Touching a way sets its bit; when that would set every
+ * bit, all others are cleared. The victim is the lowest way whose bit is clear.
+ */
+typedef struct bit_plru_state_t {
+	int set_bits;		// Number of bits currently set
+	int pad;
+	word_t bits[];
+} bit_plru_state_t;
+
+static size_t bit_plru_state_size(int ways) {
+    return sizeof(bit_plru_state_t) + sizeof(word_t) * bit_words(ways);
+}
+
+static void bit_plru_init(repl_t* r, void* state, int set) {
+    (void)set;
+    memset(state, 0, bit_plru_state_size(r->ways));
+}
+
+static void bit_plru_touch(repl_t* r, void* state, int set, int way) {
+    (void)set;
+    bit_plru_state_t* st = (bit_plru_state_t*)state;
+    if (get_bit(st->bits, way)) return;
+    put_bit(st->bits, way, 1);
+    if (++st->set_bits == r->ways) {
+        memset(st->bits, 0, sizeof(word_t) * bit_words(r->ways));
+        put_bit(st->bits, way, 1);
+        st->set_bits = 1;
+    }
+}
+
+static int bit_plru_victim(repl_t* r, void* state, int set) {
+    (void)set;
+    const bit_plru_state_t* st = (const bit_plru_state_t*)state;
+    for (int w = 0; w < bit_words(r->ways); w++) {
+        int left = r->ways - w * WORD_BITS;
+        word_t in_set = left < WORD_BITS ? (1ULL << left) - 1 : ~0ULL;
+        word_t clear = ~st->bits[w] & in_set;
+        if (clear) return w * WORD_BITS + __builtin_ctzll(clear);
+    }
+    return 0;
+}
+
+/*
+ * RRIP family: a 2-bit re-reference prediction value (RRPV) per way, packed 32 to a
+ * word. Hits set the RRPV to 0. The victim is the lowest way with RRPV 3; if there is
+ * none, every RRPV is aged by the amount that makes the largest one 3, which is a
+ * single add on each packed word.
+ */
+#define RRPV_MAX 3
+#define RRPV_PER_WORD 32
+#define RRPV_LOW_BITS 0x5555555555555555ULL
+#define BRRIP_LONG_ONE_IN 32	// BRRIP inserts at RRPV_MAX-1 once every this many fills
+
+#define PSEL_MAX 1023			// DRRIP: 10-bit policy selector
+#define DUEL_LEADERS 32			// DRRIP: leader sets per policy
+
+typedef struct rrip_state_t {
+	unsigned int rng;		// BRRIP insertion coin
+	unsigned int pad;
+	word_t rrpv[];
+} rrip_state_t;
+
+static inline int rrpv_words(int ways) {
+    return (ways + RRPV_PER_WORD - 1) / RRPV_PER_WORD;
+}
+
+static inline word_t rrpv_fields(int ways, int w) {
+    int left = ways - w * RRPV_PER_WORD;
+    return left < RRPV_PER_WORD ? (1ULL << (2 * left)) - 1 : ~0ULL;
+}
+
+static inline void set_rrpv(rrip_state_t* st, int way, int value) {
+    int shift = 2 * (way % RRPV_PER_WORD);
+    word_t* word = &st->rrpv[way / RRPV_PER_WORD];
+    *word = (*word & ~(3ULL << shift)) | ((word_t)value << shift);
+}
+
+static size_t rrip_state_size(int ways) {
+    return sizeof(rrip_state_t) + sizeof(word_t) * rrpv_words(ways);
+}
+
+static void rrip_init(repl_t* r, void* state, int set) {
+    rrip_state_t* st = (rrip_state_t*)state;
+    memset(st, 0, rrip_state_size(r->ways));
+    st->rng = random_seed(set);
+    // Empty ways are filled before the policy is asked, so start them as distant
+    for (int w = 0; w < rrpv_words(r->ways); w++) {
+        st->rrpv[w] = rrpv_fields(r->ways, w);
+    }
+}
+
+static void rrip_hit(repl_t* r, void* state, int set, int way) {
+    (void)r;
+    (void)set;
+    set_rrpv((rrip_state_t*)state, way, 0);
+}
+
+static int rrip_victim(repl_t* r, void* state, int set) {
+    (void)set;
+    rrip_state_t* st = (rrip_state_t*)state;
+    int words = rrpv_words(r->ways);
+    int any_high = 0;
+    int any_low = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int w = 0; w < words; w++) {
+            word_t x = st->rrpv[w];
+            word_t distant = x & (x >> 1) & RRPV_LOW_BITS;
+            if (distant) return w * RRPV_PER_WORD + __builtin_ctzll(distant) / 2;
+            any_high |= (x & (RRPV_LOW_BITS << 1)) != 0;
+            any_low |= (x & RRPV_LOW_BITS) != 0;
+        }
+        // Age everyone so the largest RRPV becomes RRPV_MAX. Nothing overflows.
+        word_t delta = any_high ? 1 : (any_low ? 2 : 3);
+        for (int w = 0; w < words; w++) {
+            st->rrpv[w] += delta * (RRPV_LOW_BITS & rrpv_fields(r->ways, w));
+        }
+    }
+    return 0;
+}
+
+static void srrip_fill(repl_t* r, void* state, int set, int way) {
+    (void)r;
+    (void)set;
+    set_rrpv((rrip_state_t*)state, way, RRPV_MAX - 1);
+}
+
+static void brrip_fill(repl_t* r, void* state, int set, int way) {
+    (void)r;
+    (void)set;
+    rrip_state_t* st = (rrip_state_t*)state;
+    int long_insert = next_random(&st->rng) % BRRIP_LONG_ONE_IN == 0;
+    set_rrpv(st, way, long_insert ? RRPV_MAX - 1 : RRPV_MAX);
+}
+
+/**
+ * Function to classify a set for DRRIP set dueling.
+ *
+ * @return 1 for an SRRIP leader, 2 for a BRRIP leader, 0 for a follower.
+ */
+static inline int drrip_leader(const repl_t* r, int set) {
+    int stride = r->num_sets / DUEL_LEADERS;
+    if (stride < 2) stride = 2;
+    if (set % stride == 0) return 1;
+    if (set % stride == 1) return 2;
+    return 0;
+}
+
+static void drrip_fill(repl_t* r, void* state, int set, int way) {
+    // Fills are misses: misses in a leader set count against its policy
+    switch (drrip_leader(r, set)) {
+    case 1:
+        if (r->psel < PSEL_MAX) r->psel++;
+        srrip_fill(r, state, set, way);
+        break;
+    case 2:
+        if (r->psel > 0) r->psel--;
+        brrip_fill(r, state, set, way);
+        break;
+    default:
+        if (r->psel > PSEL_MAX / 2) {
+            brrip_fill(r, state, set, way);
+        } else {
+            srrip_fill(r, state, set, way);
+        }
+    }
+}
+
+/**
+ * Hit/fill handler for policies that do not care about the event.
+ */
+static void no_update(repl_t* r, void* state, int set, int way) {
+    (void)r;
+    (void)state;
+    (void)set;
+    (void)way;
+}
+
+/*
+ * FIFO: a round-robin pointer. Invalid blocks are filled in way order, so once the set
+ * is full the pointer sits on the oldest block.
+ */
+static size_t fifo_state_size(int ways) {
+    (void)ways;
+    return sizeof(unsigned int);
+}
+
+static void fifo_init(repl_t* r, void* state, int set) {
+    (void)r;
+    (void)set;
+    *(unsigned int*)state = 0;
+}
+
+static void fifo_fill(repl_t* r, void* state, int set, int way) {
+    (void)set;
+    *(unsigned int*)state = (unsigned int)(way + 1) % (unsigned int)r->ways;
+}
+
+static int fifo_victim(repl_t* r, void* state, int set) {
+    (void)r;
+    (void)set;
+    return (int)*(unsigned int*)state;
+}
+
+/*
+ * Random: a uniformly random victim from the per-set generator.
+ */
+static size_t random_state_size(int ways) {
+    (void)ways;
+    return sizeof(unsigned int);
+}
+
+static void random_init(repl_t* r, void* state, int set) {
+    (void)r;
+    *(unsigned int*)state = random_seed(set);
+}
+
+static int random_victim(repl_t* r, void* state, int set) {
+    (void)set;
+    return (int)(next_random((unsigned int*)state) % (unsigned int)r->ways);
+}
+
+/*
+ * LFU: a saturating use count per way. Fills start at 1; the victim is the way with the
+ * smallest count.
+ */
+static size_t lfu_state_size(int ways) {
+    return sizeof(unsigned int) * ways;
+}
+
+static void lfu_init(repl_t* r, void* state, int set) {
+    (void)set;
+    memset(state, 0, lfu_state_size(r->ways));
+}
+
+static void lfu_hit(repl_t* r, void* state, int set, int way) {
+    (void)r;
+    (void)set;
+    unsigned int* counts = (unsigned int*)state;
+    if (counts[way] != ~0u) counts[way]++;
+}
+
+static void lfu_fill(repl_t* r, void* state, int set, int way) {
+    (void)r;
+    (void)set;
+    ((unsigned int*)state)[way] = 1;
+}
+
+static int lfu_victim(repl_t* r, void* state, int set) {
+    (void)set;
+    const unsigned int* counts = (const unsigned int*)state;
+    int victim = 0;
+    for (int i = 1; i < r->ways; i++) {
+        if (counts[i] < counts[victim]) victim = i;
+    }
+    return victim;
+}
+
+static const repl_policy_t policies[] = {
+    { "lru", 0, lru_state_size, lru_init, lru_touch, lru_touch, lru_victim, lru_relocate },
+    { "tree-plru", 0, tree_plru_state_size, tree_plru_init,
+      tree_plru_touch, tree_plru_touch, tree_plru_victim, NULL },
+    { "bit-plru", 0, bit_plru_state_size, bit_plru_init,
+      bit_plru_touch, bit_plru_touch, bit_plru_victim, NULL },
+    { "srrip", 0, rrip_state_size, rrip_init, rrip_hit, srrip_fill, rrip_victim, NULL },
+    { "brrip", 0, rrip_state_size, rrip_init, rrip_hit, brrip_fill, rrip_victim, NULL },
+    { "drrip", 1, rrip_state_size, rrip_init, rrip_hit, drrip_fill, rrip_victim, NULL },
+    { "fifo", 0, fifo_state_size, fifo_init, no_update, fifo_fill, fifo_victim, NULL },
+    { "random", 0, random_state_size, random_init, no_update, no_update, random_victim, NULL },
+    { "lfu", 0, lfu_state_size, lfu_init, lfu_hit, lfu_fill, lfu_victim, NULL },
+};
+
+#define NUM_POLICIES ((int)(sizeof(policies) / sizeof(policies[0])))
+
+const repl_policy_t* repl_find(const char* name) {
+    for (int i = 0; i < NUM_POLICIES; i++) {
+        if (strcmp(policies[i].name, name) == 0) return &policies[i];
+    }
+    return NULL;
+}
+
+void repl_print_names(FILE* out, const char* sep) {
+    for (int i = 0; i < NUM_POLICIES; i++) {
+        fprintf(out, "%s%s", i ? sep : "", policies[i].name);
+    }
+}
+
+repl_t* repl_create(const repl_policy_t* policy, int num_sets, int ways) {
+    repl_t* r = (repl_t*)malloc(sizeof(repl_t));
+    r->policy = policy;
+    r->ways = ways;
+    r->num_sets = num_sets;
+    r->state_size = (policy->state_size(ways) + 7) & ~(size_t)7;
+    r->state = (unsigned char*)calloc(num_sets, r->state_size);
+    r->psel = PSEL_MAX / 2;
+    for (int i = 0; i < num_sets; i++) {
+        policy->init(r, repl_set_state(r, i), i);
+    }
+    return r;
+}
+
+int repl_save(const repl_t* r, FILE* out) {
+    size_t bytes = r->state_size * r->num_sets;
+    if (fwrite(&r->psel, sizeof(r->psel), 1, out) != 1) return -1;
+    return fwrite(r->state, 1, bytes, out) == bytes ? 0 : -1;
+}
+
+int repl_load(repl_t* r, FILE* in) {
+    size_t bytes = r->state_size * r->num_sets;
+    if (fread(&r->psel, sizeof(r->psel), 1, in) != 1) return -1;
+    if (fread(r->state, 1, bytes, in) != bytes) return -1;
+    if (r->policy->relocate) {
+        for (int i = 0; i < r->num_sets; i++) {
+            r->policy->relocate(r, repl_set_state(r, i), i);
+        }
+    }
+    return 0;
+}
+
+void repl_free(repl_t* r) {
+    free(r->state);
+    free(r);
+}
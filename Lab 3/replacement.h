@@ -0,0 +1,103 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __REPLACEMENT_H
+#define __REPLACEMENT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * Replacement policies. A policy is a table of functions plus a description of how much
+ * state it keeps per set. A repl_t holds one policy's state for every set of a cache
+ * in a single allocation, so cheap policies (a pointer, a few bits per way) stay cheap.
+ *
+ * The cache fills invalid blocks on its own and only asks the policy for a victim once
+ * a set is full. It tells the policy about every hit and every fill.
+ *
+ * Available policies:
+ *  - lru:       true LRU via the O(1) LRU stack
+ *  - tree-plru: tree pseudo-LRU, ways-1 bits per set
+ *  - bit-plru:  MRU-bit pseudo-LRU, one bit per way
+ *  - srrip:     static re-reference interval prediction, 2 bits per way
+ *  - brrip:     bimodal RRIP, inserts at distant re-reference most of the time
+ *  - drrip:     dynamic RRIP, picks SRRIP or BRRIP by set dueling
+ *  - fifo:      round-robin
+ *  - random:    uniformly random victim, from a per-set generator
+ *  - lfu:       least frequently used, ties go to the lowest way
+ */
+
+typedef struct repl_t repl_t;
+
+typedef struct repl_policy_t {
+	const char* name;
+	int shared_state;	// 1 if sets influence each other (set dueling), 0 otherwise
+	size_t (*state_size)(int ways);		// Bytes of state per set
+	void (*init)(repl_t* r, void* state, int set);
+	void (*on_hit)(repl_t* r, void* state, int set, int way);
+	void (*on_fill)(repl_t* r, void* state, int set, int way);
+	int (*victim)(repl_t* r, void* state, int set);
+	// Fixes up a set's state after it is loaded from a checkpoint, if the state holds
+	// anything that depends on its address. NULL for plain data.
+	void (*relocate)(repl_t* r, void* state, int set);
+} repl_policy_t;
+
+struct repl_t {
+	const repl_policy_t* policy;
+	int ways;
+	int num_sets;
+	size_t state_size;		// Per-set state size, rounded up to 8 bytes
+	unsigned char* state;	// State of all sets, set i at i * state_size
+	int psel;				// DRRIP: policy selector, high half favours BRRIP
+};
+
+/**
+ * Function to look up a policy by name.
+ *
+ * @param name is the policy name, e.g. "lru" or "srrip".
+ * @return the policy, or NULL if there is no such policy.
+ */
+const repl_policy_t* repl_find(const char* name);
+
+/**
+ * Function to print the names of all policies, separated by <sep>.
+ */
+void repl_print_names(FILE* out, const char* sep);
+
+/**
+ * Function to create the state of <policy> for a cache with <num_sets> sets of
+ * <ways> ways.
+ *
+ * @return the dynamically allocated state.
+ */
+repl_t* repl_create(const repl_policy_t* policy, int num_sets, int ways);
+
+/**
+ * Function to write the state of <r> to <out>, for a checkpoint.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int repl_save(const repl_t* r, FILE* out);
+
+/**
+ * Function to read state written by repl_save into <r>, which must have been created
+ * with the same policy and geometry.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int repl_load(repl_t* r, FILE* in);
+
+/**
+ * Function to free the state created by repl_create.
+ */
+void repl_free(repl_t* r);
+
+/**
+ * Function to get the state of set <set>.
+ */
+static inline void* repl_set_state(repl_t* r, int set) {
+	return r->state + (size_t)set * r->state_size;
+}
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reuse.h"
+
+#define DROPPED_BITS_PER_KEY 64
+#define MIN_DROPPED_BITS 23		// log2 of the smallest filter: 1 MB
+#define DROPPED_PROBES 3
+
+/**
+ * @return the bit of probe <i> for <key> in the dropped filter. The probes are
+ *      double hashed from two multiplicative hashes of <key>.
+ */
+static inline unsigned long long dropped_bit(const reuse_tracker_t* t, addr_t key, int i) {
+    unsigned long long h1 = key * 0x9e3779b97f4a7c15ULL;
+    unsigned long long h2 = ((key ^ (key >> 29)) * 0xbf58476d1ce4e5b9ULL) | 1;
+    return (h1 + i * h2) >> (64 - t->dropped_bits);
+}
+
+static int dropped_test(const reuse_tracker_t* t, addr_t key) {
+    for (int i = 0; i < DROPPED_PROBES; i++) {
+        unsigned long long bit = dropped_bit(t, key, i);
+        if (!((t->dropped[bit / 64] >> (bit % 64)) & 1)) return 0;
+    }
+    return 1;
+}
+
+static void dropped_add(reuse_tracker_t* t, addr_t key) {
+    for (int i = 0; i < DROPPED_PROBES; i++) {
+        unsigned long long bit = dropped_bit(t, key, i);
+        t->dropped[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+static inline int subtree_size(const reuse_tracker_t* t, int node) {
+    return node < 0 ? 0 : t->nodes[node].size;
+}
+
+static inline void update_size(reuse_tracker_t* t, int node) {
+    reuse_node_t* n = &t->nodes[node];
+    n->size = 1 + subtree_size(t, n->left) + subtree_size(t, n->right);
+}
+
+/**
+ * Function to rotate <x> above its parent.
+ */
+static void rotate(reuse_tracker_t* t, int x) {
+    int p = t->nodes[x].parent;
+    int g = t->nodes[p].parent;
+    if (t->nodes[p].left == x) {
+        t->nodes[p].left = t->nodes[x].right;
+        if (t->nodes[x].right >= 0) t->nodes[t->nodes[x].right].parent = p;
+        t->nodes[x].right = p;
+    } else {
+        t->nodes[p].right = t->nodes[x].left;
+        if (t->nodes[x].left >= 0) t->nodes[t->nodes[x].left].parent = p;
+        t->nodes[x].left = p;
+    }
+    t->nodes[p].parent = x;
+    t->nodes[x].parent = g;
+    if (g >= 0) {
+        if (t->nodes[g].left == p) {
+            t->nodes[g].left = x;
+        } else {
+            t->nodes[g].right = x;
+        }
+    }
+    update_size(t, p);
+    update_size(t, x);
+}
+
+/**
+ * Function to splay <x> to the root of the tree it is in.
+ */
+static void splay(reuse_tracker_t* t, int x) {
+    while (t->nodes[x].parent >= 0) {
+        int p = t->nodes[x].parent;
+        int g = t->nodes[p].parent;
+        if (g < 0) {
+            rotate(t, x);
+        } else if ((t->nodes[p].left == x) == (t->nodes[g].left == p)) {
+            // Zig-zig: rotate the parent first
+            rotate(t, p);
+            rotate(t, x);
+        } else {
+            rotate(t, x);
+            rotate(t, x);
+        }
+    }
+    t->root = x;
+}
+
+/**
+ * Function to take the root out of the tree, joining its two subtrees.
+ */
+static void remove_root(reuse_tracker_t* t) {
+    int left = t->nodes[t->root].left;
+    int right = t->nodes[t->root].right;
+    if (left >= 0) t->nodes[left].parent = -1;
+    if (right >= 0) t->nodes[right].parent = -1;
+    if (left < 0) {
+        t->root = right;
+        return;
+    }
+
+    // The largest node on the left becomes the root, with no right child
+    int max = left;
+    while (t->nodes[max].right >= 0) max = t->nodes[max].right;
+    splay(t, max);
+    t->nodes[max].right = right;
+    if (right >= 0) t->nodes[right].parent = max;
+    update_size(t, max);
+}
+
+/**
+ * Function to add <node> to the tree as its largest node, i.e. the most recently
+ * touched.
+ */
+static void push_newest(reuse_tracker_t* t, int node) {
+    t->nodes[node].left = t->root;
+    t->nodes[node].right = -1;
+    t->nodes[node].parent = -1;
+    if (t->root >= 0) t->nodes[t->root].parent = node;
+    t->root = node;
+    t->newest = node;
+    update_size(t, node);
+}
+
+reuse_tracker_t* reuse_create(int capacity) {
+    reuse_tracker_t* t = (reuse_tracker_t*)calloc(1, sizeof(reuse_tracker_t));
+    t->capacity = capacity;
+    t->root = -1;
+    t->newest = -1;
+    t->nodes = (reuse_node_t*)malloc(sizeof(reuse_node_t) * capacity);
+    t->keys = (addr_t*)malloc(sizeof(addr_t) * capacity);
+    t->times = (counter_t*)malloc(sizeof(counter_t) * capacity);
+    for (int i = 0; i < capacity; i++) {
+        t->nodes[i].right = i + 1 < capacity ? i + 1 : -1;
+    }
+    t->free_list = capacity > 0 ? 0 : -1;
+
+    line_map_init(&t->map, capacity, 1);
+    t->dropped_bits = MIN_DROPPED_BITS;
+    while ((1LL << t->dropped_bits) < (long long)DROPPED_BITS_PER_KEY * capacity) {
+        t->dropped_bits++;
+    }
+    t->dropped = (unsigned long long*)calloc((size_t)1 << (t->dropped_bits - 6),
+                                             sizeof(unsigned long long));
+    return t;
+}
+
+long long reuse_access(reuse_tracker_t* t, addr_t key, counter_t* last_time) {
+    counter_t now = t->now++;
+    // Touching the same key again is common, and needs neither the map nor the tree
+    if (t->newest >= 0 && t->keys[t->newest] == key) {
+        *last_time = t->times[t->newest];
+        t->times[t->newest] = now;
+        return 0;
+    }
+
+    int node = (int)line_map_find(&t->map, key);
+    if (node >= 0) {
+        splay(t, node);
+        long long distance = subtree_size(t, t->nodes[node].right);
+        *last_time = t->times[node];
+        t->times[node] = now;
+        if (distance > 0) {
+            remove_root(t);
+            push_newest(t, node);
+        }
+        return distance;
+    }
+
+    long long result = dropped_test(t, key) ? REUSE_BEYOND : REUSE_COLD;
+
+    if (t->free_list >= 0) {
+        node = t->free_list;
+        t->free_list = t->nodes[node].right;
+        t->count++;
+    } else {
+        // Drop the least recently touched key and reuse its node
+        node = t->root;
+        while (t->nodes[node].left >= 0) node = t->nodes[node].left;
+        splay(t, node);
+        remove_root(t);
+        line_map_remove(&t->map, t->keys[node], NULL);
+        dropped_add(t, t->keys[node]);
+    }
+    t->keys[node] = key;
+    t->times[node] = now;
+    push_newest(t, node);
+    line_map_insert(&t->map, key, node);
+    return result;
+}
+
+void reuse_free(reuse_tracker_t* t) {
+    if (!t) return;
+    free(t->nodes);
+    free(t->keys);
+    free(t->times);
+    line_map_free(&t->map);
+    free(t->dropped);
+    free(t);
+}
@@ -0,0 +1,77 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __REUSE_H
+#define __REUSE_H
+
+#include "cachesim.h"
+
+/**
+ * Reuse distances: the number of distinct keys (e.g. line addresses) touched between
+ * two accesses to the same key. A key with distance d hits in a fully associative
+ * LRU cache of more than d entries.
+ *
+ * Every key seen is a node in a splay tree ordered by the time it was last touched,
+ * with subtree sizes, so the distance of an access is the number of nodes to the
+ * right of its key's node. Splaying that node to the root makes the count the size of
+ * its right subtree. The node is then taken out and put back at the far right, as the
+ * most recently touched. Every operation is O(log n) amortized, unlike the linear
+ * search of an lru_dist_stack_t.
+ *
+ * The tree is bounded: at most <capacity> keys are tracked. When a new key would go
+ * past that, the least recently touched key is dropped. A later access to a dropped key
+ * is reported as beyond the capacity, since its distance is at least that large.
+ * Dropped keys are remembered in a Bloom filter of 64 bits per key of capacity, and at
+ * least 1 MB, so memory stays fixed however long the trace is. The filter never misses
+ * a dropped key, but once far more keys have been dropped than it was sized for, it
+ * also claims some new keys. Cold counts are then approximate: they can only be too
+ * low, and the accesses they miss are counted as beyond instead.
+ */
+
+#define REUSE_COLD -1		// The key has never been seen, as far as the filter can tell
+#define REUSE_BEYOND -2		// The key was dropped; its distance is at least the capacity
+
+typedef struct reuse_node_t {
+	int left;				// Links, -1 for none
+	int right;
+	int parent;
+	int size;				// Nodes in this subtree
+} reuse_node_t;
+
+typedef struct reuse_tracker_t {
+	int capacity;			// Maximum keys tracked
+	int root;				// Root node, -1 if the tree is empty
+	int free_list;			// First unused node, linked through <right>
+	int count;				// Nodes in the tree
+	int newest;				// Node of the most recently touched key, -1 if none
+	reuse_node_t* nodes;	// Tree nodes; the links of a node share one cache line
+	addr_t* keys;			// Key of each node
+	counter_t* times;		// Time each node's key was last touched
+	counter_t now;			// Accesses so far
+	line_map_t map;			// Key to node
+	unsigned long long* dropped;	// Bloom filter of the keys ever dropped at capacity
+	int dropped_bits;		// log2 of the filter size in bits
+} reuse_tracker_t;
+
+/**
+ * Function to create a tracker for at most <capacity> keys.
+ *
+ * @return the dynamically allocated tracker.
+ */
+reuse_tracker_t* reuse_create(int capacity);
+
+/**
+ * Function to touch <key>.
+ *
+ * @param last_time is set to when <key> was last touched, if it was being tracked.
+ * @return the reuse distance of this access, REUSE_COLD or REUSE_BEYOND.
+ */
+long long reuse_access(reuse_tracker_t* t, addr_t key, counter_t* last_time);
+
+/**
+ * Function to free <t>.
+ */
+void reuse_free(reuse_tracker_t* t);
+
+#endif
@@ -0,0 +1,237 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sample.h"
+
+// Two-sided 95% quantile of the normal distribution
+#define Z_95 1.96
+
+#define SHUFFLE_SEED 0x2545f4914f6cdd1dULL
+
+// Marks an access that is simulated to warm the cache but not measured
+#define WARMUP_UNIT ((size_t)-1)
+
+/**
+ * Function to make room for units up to and including <unit>.
+ */
+static void reserve_units(sample_t* s, size_t unit) {
+    if (unit < s->max_units) return;
+    size_t old = s->max_units;
+    while (s->max_units <= unit) s->max_units = s->max_units ? s->max_units * 2 : 64;
+    s->accesses = (counter_t*)realloc(s->accesses, sizeof(counter_t) * s->max_units);
+    s->misses = (counter_t*)realloc(s->misses, sizeof(counter_t) * s->max_units);
+    s->writebacks = (counter_t*)realloc(s->writebacks, sizeof(counter_t) * s->max_units);
+    size_t added = s->max_units - old;
+    memset(s->accesses + old, 0, sizeof(counter_t) * added);
+    memset(s->misses + old, 0, sizeof(counter_t) * added);
+    memset(s->writebacks + old, 0, sizeof(counter_t) * added);
+}
+
+/**
+ * Function to choose which sets to simulate: a fixed pseudo-random subset, so that
+ * strided access patterns cannot line up with the sample. The first num_units sets of
+ * a partial Fisher-Yates shuffle are chosen, and set_units maps each to its unit.
+ */
+static void choose_sets(sample_t* s) {
+    int num_sets = s->cache->num_sets;
+    int* order = (int*)malloc(sizeof(int) * num_sets);
+    for (int i = 0; i < num_sets; i++) {
+        order[i] = i;
+    }
+    unsigned long long state = SHUFFLE_SEED;
+    for (size_t i = 0; i < s->num_units; i++) {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size_t j = i + state % (num_sets - i);
+        int chosen = order[j];
+        order[j] = order[i];
+        order[i] = chosen;
+    }
+
+    s->set_units = (int*)malloc(sizeof(int) * num_sets);
+    for (int i = 0; i < num_sets; i++) {
+        s->set_units[i] = -1;
+    }
+    for (size_t i = 0; i < s->num_units; i++) {
+        s->set_units[order[i]] = (int)i;
+    }
+    free(order);
+}
+
+sample_t* sample_create(const char* spec, cache_t* c) {
+    sample_t* s = (sample_t*)calloc(1, sizeof(sample_t));
+    s->cache = c;
+    char* end;
+    if (strncmp(spec, "sets:", 5) == 0) {
+        long ratio = strtol(spec + 5, &end, 10);
+        if (end == spec + 5 || *end || ratio < 1 || ratio > c->num_sets) {
+            free(s);
+            return NULL;
+        }
+        s->mode = SAMPLE_SETS;
+        s->ratio = (int)ratio;
+        s->num_units = (c->num_sets + ratio - 1) / ratio;
+        reserve_units(s, s->num_units - 1);
+        choose_sets(s);
+        return s;
+    }
+
+    if (strncmp(spec, "time:", 5) != 0) {
+        free(s);
+        return NULL;
+    }
+    const char* p = spec + 5;
+    long long period = strtoll(p, &end, 10);
+    long long detail = 0;
+    long long warmup = -1;
+    int valid = end != p && *end == ':';
+    if (valid) {
+        p = end + 1;
+        detail = strtoll(p, &end, 10);
+        valid = end != p;
+    }
+    if (valid && *end == ':') {
+        p = end + 1;
+        warmup = strtoll(p, &end, 10);
+        valid = end != p && warmup >= 0;
+    }
+    if (warmup < 0) {
+        warmup = 2LL * c->num_blocks;
+        if (valid && warmup > period - detail) warmup = period - detail;
+    }
+    if (!valid || *end || detail < 1 || period < detail + warmup) {
+        free(s);
+        return NULL;
+    }
+    s->mode = SAMPLE_TIME;
+    s->period = (counter_t)period;
+    s->detail = (counter_t)detail;
+    s->warmup = (counter_t)warmup;
+    return s;
+}
+
+counter_t sample_run(sample_t* s, trace_t* trace) {
+    cache_t* c = s->cache;
+    addr_t addrs[TRACE_BATCH_SIZE];
+    int types[TRACE_BATCH_SIZE];
+    size_t units[TRACE_BATCH_SIZE];
+    unsigned char results[TRACE_BATCH_SIZE];
+    addr_t set_mask = (addr_t)c->num_sets - 1;
+    counter_t skipped = s->period - s->warmup - s->detail;
+    counter_t measured = s->period - s->detail;
+    const trace_record_t* batch;
+    size_t n;
+
+    while ((n = trace_next_batch(trace, &batch)) > 0) {
+        size_t m = 0;
+        for (size_t i = 0; i < n; i++) {
+            size_t unit;
+            if (s->mode == SAMPLE_SETS) {
+                int set_unit = s->set_units[(batch[i].addr >> c->num_offset_bits) & set_mask];
+                if (set_unit < 0) continue;
+                unit = (size_t)set_unit;
+            } else {
+                counter_t at = s->total + i;
+                counter_t phase = at % s->period;
+                if (phase < skipped) continue;
+                unit = phase < measured ? WARMUP_UNIT : at / s->period;
+            }
+            addrs[m] = batch[i].addr;
+            types[m] = trace_record_type(&batch[i]);
+            units[m++] = unit;
+        }
+        s->total += n;
+        if (!m) continue;
+
+        cache_access_batch_results(c, addrs, types, m, results);
+        for (size_t i = 0; i < m; i++) {
+            size_t unit = units[i];
+            if (unit == WARMUP_UNIT) continue;
+            if (s->mode == SAMPLE_TIME && unit >= s->num_units) {
+                reserve_units(s, unit);
+                s->num_units = unit + 1;
+            }
+            s->accesses[unit]++;
+            s->misses[unit] += results[i] != ACCESS_HIT;
+            s->writebacks[unit] += results[i] == ACCESS_WRITEBACK;
+        }
+    }
+    return s->total;
+}
+
+/**
+ * Function to estimate the ratio of <counts> to accesses over all units, as a ratio
+ * estimator over a simple random sample of units.
+ *
+ * @param fraction is the fraction of all units in the sample, for the finite
+ *      population correction.
+ * @param half_width is set to the half-width of the 95% confidence interval, or NaN
+ *      if the sample has fewer than two units with accesses.
+ * @return the estimated ratio.
+ */
+static double estimate_ratio(const sample_t* s, const counter_t* counts, double fraction,
+                             double* half_width) {
+    double total_accesses = 0;
+    double total_counts = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < s->num_units; i++) {
+        total_accesses += s->accesses[i];
+        total_counts += counts[i];
+        n += s->accesses[i] > 0;
+    }
+    *half_width = NAN;
+    if (total_accesses == 0) return 0.0;
+    double ratio = total_counts / total_accesses;
+    if (n < 2) return ratio;
+
+    // Units without accesses count as units, but add nothing to either sum
+    double sum_squares = 0;
+    for (size_t i = 0; i < s->num_units; i++) {
+        double residual = counts[i] - ratio * s->accesses[i];
+        sum_squares += residual * residual;
+    }
+    double units = (double)s->num_units;
+    double variance = (1 - fraction) * units * (sum_squares / (units - 1))
+                      / (total_accesses * total_accesses);
+    *half_width = Z_95 * sqrt(variance);
+    return ratio;
+}
+
+void sample_print_stats(const sample_t* s, FILE* out) {
+    // Set sampling covers a known fraction of the sets; time sampling too small a
+    // fraction of the periods for the correction to matter
+    double fraction = s->mode == SAMPLE_SETS
+                      ? (double)s->num_units / s->cache->num_sets : 0.0;
+    double miss_ci, writeback_ci;
+    double miss_rate = estimate_ratio(s, s->misses, fraction, &miss_ci);
+    double writeback_rate = estimate_ratio(s, s->writebacks, fraction, &writeback_ci);
+
+    counter_t misses = (counter_t)llround(miss_rate * s->total);
+    counter_t writebacks = (counter_t)llround(writeback_rate * s->total);
+    fprintf(out, "%llu, %llu, %llu, %llu\n", s->total, s->total - misses, misses, writebacks);
+
+    counter_t sampled = 0;
+    for (size_t i = 0; i < s->num_units; i++) {
+        sampled += s->accesses[i];
+    }
+    fprintf(out, "sampled_accesses, units, miss_rate, miss_rate_ci95, writeback_rate,"
+                 " writeback_rate_ci95\n");
+    fprintf(out, "%llu, %zu, %.6f, %.6f, %.6f, %.6f\n", sampled, s->num_units, miss_rate,
+            miss_ci, writeback_rate, writeback_ci);
+}
+
+void sample_free(sample_t* s) {
+    if (!s) return;
+    free(s->accesses);
+    free(s->misses);
+    free(s->writebacks);
+    free(s->set_units);
+    free(s);
+}
@@ -0,0 +1,77 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __SAMPLE_H
+#define __SAMPLE_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * Sampled simulation, for traces too long to simulate in full. Two kinds:
+ *  - set sampling:  only one set in every <ratio>, chosen pseudo-randomly, is
+ *                   simulated. Accesses to the other sets are dropped without touching
+ *                   the cache. Sets do not interact, so the sampled sets behave exactly
+ *                   as in a full run.
+ *  - time sampling: the trace is cut into periods of <period> accesses. In each, the
+ *                   cache skips all but the last <warmup> + <detail> accesses, warms up
+ *                   on <warmup> of them without counting them, and measures the last
+ *                   <detail>. SMARTS-style, many short windows rather than a few long
+ *                   ones.
+ *
+ * Either way the sample is a set of units: the sampled sets, or the detailed windows.
+ * The miss and writeback rates are ratio estimates over the units, and the statistics
+ * of the whole trace are those rates times the accesses in it. Each rate comes with
+ * the half-width of its 95% confidence interval, from the spread of the units' rates
+ * around the estimate.
+ */
+
+#define SAMPLE_SETS 0
+#define SAMPLE_TIME 1
+
+typedef struct sample_t {
+	cache_t* cache;			// The cache simulated
+	int mode;				// SAMPLE_SETS or SAMPLE_TIME
+	int ratio;				// Sets: one set in <ratio> is simulated
+	int* set_units;			// Sets: unit of each set, -1 if it is not simulated
+	counter_t period;		// Time: accesses per period
+	counter_t warmup;		// Time: accesses simulated but not counted per period
+	counter_t detail;		// Time: accesses measured per period
+	counter_t total;		// Accesses in the trace, sampled or not
+	size_t num_units;		// Units so far
+	size_t max_units;		// Units allocated
+	counter_t* accesses;	// Measured accesses of each unit
+	counter_t* misses;		// Misses of each unit
+	counter_t* writebacks;	// Writebacks of each unit
+} sample_t;
+
+/**
+ * Function to create a sampler for <c> from <spec>, either "sets:<ratio>" or
+ * "time:<period>:<detail>[:<warmup>]". The warmup defaults to twice the number of
+ * blocks in <c>. The sampler takes over the counting from <c>'s own statistics.
+ *
+ * @return the dynamically allocated sampler, or NULL if <spec> is invalid.
+ */
+sample_t* sample_create(const char* spec, cache_t* c);
+
+/**
+ * Function to run <trace> through the sampler.
+ *
+ * @return the number of records in the trace, simulated or not.
+ */
+counter_t sample_run(sample_t* s, trace_t* trace);
+
+/**
+ * Function to print the estimated statistics of the whole trace in the same format
+ * as cachesim_print_stats, then the sample size, and the estimated rates with their
+ * 95% confidence intervals, as a CSV header and line.
+ */
+void sample_print_stats(const sample_t* s, FILE* out);
+
+/**
+ * Function to free <s>. The cache is left alone.
+ */
+void sample_free(sample_t* s);
+
+#endif
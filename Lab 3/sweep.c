@@ -0,0 +1,242 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sweep.h"
+
+#define MAX_GRID_VALUES 64
+
+static int is_power_of_two(long x) {
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+static int config_valid(const sweep_config_t* config) {
+    return is_power_of_two(config->block_size) && is_power_of_two(config->cache_size)
+        && is_power_of_two(config->ways)
+        && (long)config->block_size * config->ways <= config->cache_size;
+}
+
+/**
+ * Function to parse one grid field, e.g. "32,64" or "1024-65536", into <values>.
+ *
+ * @return the number of values, or -1 on a syntax error.
+ */
+static int parse_grid_field(const char* field, size_t len, int* values) {
+    int n = 0;
+    const char* end = field + len;
+    const char* p = field;
+    while (p < end) {
+        char* next;
+        long lo = strtol(p, &next, 10);
+        long hi = lo;
+        if (next == p) return -1;
+        p = next;
+        if (p < end && *p == '-') {
+            p++;
+            hi = strtol(p, &next, 10);
+            if (next == p) return -1;
+            p = next;
+        }
+        if (!is_power_of_two(lo) || !is_power_of_two(hi) || lo > hi) return -1;
+        for (long v = lo; v <= hi; v *= 2) {
+            if (n == MAX_GRID_VALUES) return -1;
+            values[n++] = (int)v;
+        }
+        if (p < end) {
+            if (*p != ',') return -1;
+            p++;
+        }
+    }
+    return n;
+}
+
+/**
+ * Function to parse a comma separated list of policy names into <policies>.
+ *
+ * @return the number of policies, or -1 if a name is unknown.
+ */
+static int parse_policy_field(const char* field, const repl_policy_t** policies) {
+    int n = 0;
+    char name[64];
+    while (*field) {
+        size_t len = strcspn(field, ",");
+        if (len >= sizeof(name) || n == MAX_GRID_VALUES) return -1;
+        memcpy(name, field, len);
+        name[len] = '\0';
+        if (!(policies[n++] = repl_find(name))) return -1;
+        field += len;
+        if (*field == ',') field++;
+    }
+    return n;
+}
+
+static int parse_grid(const char* spec, const repl_policy_t* policy, sweep_config_t** configs) {
+    int values[3][MAX_GRID_VALUES];
+    int counts[3];
+    const repl_policy_t* policies[MAX_GRID_VALUES] = { policy };
+    int num_policies = 1;
+    const char* field = spec;
+    for (int f = 0; f < 3; f++) {
+        const char* colon = strchr(field, ':');
+        size_t len = colon ? (size_t)(colon - field) : strlen(field);
+        if (f < 2 && !colon) return -1;
+        counts[f] = parse_grid_field(field, len, values[f]);
+        if (counts[f] <= 0) return -1;
+        field = colon ? colon + 1 : field + len;
+        if (f == 2 && colon) {
+            num_policies = parse_policy_field(field, policies);
+            if (num_policies <= 0) return -1;
+        }
+    }
+
+    *configs = (sweep_config_t*)malloc(sizeof(sweep_config_t)
+                                       * counts[0] * counts[1] * counts[2] * num_policies);
+    int n = 0;
+    for (int b = 0; b < counts[0]; b++) {
+        for (int s = 0; s < counts[1]; s++) {
+            for (int w = 0; w < counts[2]; w++) {
+                for (int p = 0; p < num_policies; p++) {
+                    sweep_config_t config = { values[0][b], values[1][s], values[2][w], policies[p] };
+                    if (config_valid(&config)) (*configs)[n++] = config;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+static int parse_file(FILE* file, const repl_policy_t* policy, sweep_config_t** configs) {
+    int n = 0;
+    int cap = 16;
+    char line[256];
+    *configs = (sweep_config_t*)malloc(sizeof(sweep_config_t) * cap);
+
+    while (fgets(line, sizeof(line), file)) {
+        for (char* c = line; *c; c++) {
+            if (*c == ',') *c = ' ';
+        }
+        sweep_config_t config;
+        char first[2];
+        char name[64];
+        if (sscanf(line, " %1s", first) != 1 || first[0] == '#') continue;
+        int fields = sscanf(line, "%d %d %d %63s", &config.block_size, &config.cache_size,
+                            &config.ways, name);
+        config.policy = fields == 4 ? repl_find(name) : policy;
+        if (fields < 3 || !config.policy) {
+            free(*configs);
+            return -1;
+        }
+        if (!config_valid(&config)) {
+            fprintf(stderr, "Skipping invalid configuration %d %d %d\n",
+                    config.block_size, config.cache_size, config.ways);
+            continue;
+        }
+        if (n == cap) {
+            cap *= 2;
+            *configs = (sweep_config_t*)realloc(*configs, sizeof(sweep_config_t) * cap);
+        }
+        (*configs)[n++] = config;
+    }
+    return n;
+}
+
+int sweep_parse_configs(const char* spec, const repl_policy_t* policy,
+                        sweep_config_t** configs) {
+    FILE* file = fopen(spec, "r");
+    if (file) {
+        int n = parse_file(file, policy, configs);
+        fclose(file);
+        return n;
+    }
+    return parse_grid(spec, policy, configs);
+}
+
+typedef struct sweep_result_t {
+	cache_stats_t stats;
+	double seconds;
+} sweep_result_t;
+
+typedef struct sweep_pool_t {
+	const trace_record_t* records;
+	size_t count;
+	const sweep_config_t* configs;
+	int num_configs;
+	sweep_result_t* results;
+	int next;				// Next configuration to hand out
+	pthread_mutex_t lock;
+} sweep_pool_t;
+
+static void sweep_one(sweep_pool_t* pool, int i) {
+    const sweep_config_t* config = &pool->configs[i];
+    sweep_result_t* result = &pool->results[i];
+
+    addr_t addrs[TRACE_BATCH_SIZE];
+    int types[TRACE_BATCH_SIZE];
+    double start = now_seconds();
+    cache_t* c = cache_create_from_config(config);
+    for (size_t base = 0; base < pool->count; base += TRACE_BATCH_SIZE) {
+        size_t n = pool->count - base < TRACE_BATCH_SIZE ? pool->count - base : TRACE_BATCH_SIZE;
+        for (size_t r = 0; r < n; r++) {
+            addrs[r] = pool->records[base + r].addr;
+            types[r] = trace_record_type(&pool->records[base + r]);
+        }
+        cache_access_batch(c, addrs, types, n);
+    }
+    result->seconds = now_seconds() - start;
+    result->stats = cache_get_stats(c);
+    cache_free(c);
+}
+
+static void* sweep_worker(void* arg) {
+    sweep_pool_t* pool = (sweep_pool_t*)arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        int i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->num_configs) break;
+        sweep_one(pool, i);
+    }
+    return NULL;
+}
+
+void sweep_run(const trace_record_t* records, size_t count,
+               const sweep_config_t* configs, int num_configs, int threads, FILE* out) {
+    sweep_pool_t pool;
+    pool.records = records;
+    pool.count = count;
+    pool.configs = configs;
+    pool.num_configs = num_configs;
+    pool.results = (sweep_result_t*)calloc(num_configs, sizeof(sweep_result_t));
+    pool.next = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    if (threads > num_configs) threads = num_configs;
+    if (threads < 1) threads = 1;
+    pthread_t* workers = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, sweep_worker, &pool);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    fprintf(out, "block_size, cache_size, ways, policy, accesses, hits, misses, writebacks,"
+                 " seconds, accesses_per_sec\n");
+    for (int i = 0; i < num_configs; i++) {
+        const sweep_config_t* config = &configs[i];
+        const sweep_result_t* result = &pool.results[i];
+        fprintf(out, "%d, %d, %d, %s, %llu, %llu, %llu, %llu, %.6f, %.0f\n",
+                config->block_size, config->cache_size, config->ways, config->policy->name,
+                result->stats.accesses, result->stats.hits, result->stats.misses,
+                result->stats.writebacks, result->seconds,
+                result->seconds > 0 ? result->stats.accesses / result->seconds : 0.0);
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+    free(workers);
+    free(pool.results);
+}
@@ -0,0 +1,49 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __SWEEP_H
+#define __SWEEP_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * Multi-configuration sweeps. The trace is decoded into memory once and every
+ * configuration is simulated against it on a pool of worker threads, one cache_t
+ * per configuration.
+ */
+
+typedef cache_config_t sweep_config_t;
+
+/**
+ * Function to parse a list of configurations. <spec> is either the name of a file with
+ * one "<block size> <cache size> <ways> [policy]" line per configuration, or a grid of
+ * the form BLOCKS:SIZES:WAYS[:POLICIES], where each field is a comma separated list of
+ * values or ranges A-B (every power of two from A to B), or of policy names. Grid
+ * points that do not describe a valid cache (ways * block size larger than the cache)
+ * are skipped.
+ *
+ * @param spec is the file name or grid
+ * @param policy is the policy of configurations that do not name one
+ * @param configs is set to a dynamically allocated array of configurations
+ * @return the number of configurations, or -1 if <spec> could not be parsed
+ */
+int sweep_parse_configs(const char* spec, const repl_policy_t* policy,
+                        sweep_config_t** configs);
+
+/**
+ * Function to simulate every configuration against <records> and print one CSV line
+ * per configuration, in the order given, to <out>.
+ *
+ * @param records is the decoded trace
+ * @param count is the number of records
+ * @param configs is the array of configurations
+ * @param num_configs is the number of configurations
+ * @param threads is the number of worker threads
+ * @param out is where to print the results
+ */
+void sweep_run(const trace_record_t* records, size_t count,
+               const sweep_config_t* configs, int num_configs, int threads, FILE* out);
+
+#endif
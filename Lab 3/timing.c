@@ -0,0 +1,178 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timing.h"
+
+#define DEFAULT_WINDOW 128
+
+static const char* file_names[] = { "l1i", "l1d" };
+
+static void mshr_init(mshr_file_t* f, int size) {
+    f->size = size;
+    f->lines = (addr_t*)calloc(size, sizeof(addr_t));
+    f->ready = (counter_t*)calloc(size, sizeof(counter_t));
+    f->histogram = (counter_t*)calloc(size + 1, sizeof(counter_t));
+    f->pending = (counter_t*)malloc(sizeof(counter_t) * size);
+    f->swept = 0;
+}
+
+static void mshr_cleanup(mshr_file_t* f) {
+    free(f->lines);
+    free(f->ready);
+    free(f->histogram);
+    free(f->pending);
+}
+
+/**
+ * Function to add the cycles from f->swept up to <until> to the occupancy histogram.
+ * MSHRs are only allocated at cycles already swept, so over this stretch the busy
+ * count only drops, once at each ready cycle.
+ */
+static void mshr_sweep(mshr_file_t* f, counter_t until) {
+    if (until <= f->swept) return;
+
+    // The ready cycles of the MSHRs busy at f->swept, in ascending order
+    counter_t* pending = f->pending;
+    int busy = 0;
+    for (int i = 0; i < f->size; i++) {
+        if (f->ready[i] <= f->swept) continue;
+        int j = busy++;
+        while (j > 0 && pending[j - 1] > f->ready[i]) {
+            pending[j] = pending[j - 1];
+            j--;
+        }
+        pending[j] = f->ready[i];
+    }
+
+    counter_t cycle = f->swept;
+    for (int i = 0; i < busy && pending[i] < until; i++) {
+        f->histogram[busy - i] += pending[i] - cycle;
+        cycle = pending[i];
+    }
+    int still_busy = 0;
+    for (int i = 0; i < busy; i++) {
+        still_busy += pending[i] >= until;
+    }
+    f->histogram[still_busy] += until - cycle;
+    f->swept = until;
+}
+
+/**
+ * @return the MSHR fetching <line> whose block has not arrived by <cycle>, or -1.
+ */
+static int mshr_find(const mshr_file_t* f, addr_t line, counter_t cycle) {
+    for (int i = 0; i < f->size; i++) {
+        if (f->ready[i] > cycle && f->lines[i] == line) return i;
+    }
+    return -1;
+}
+
+/**
+ * @return the MSHR that frees up first.
+ */
+static int mshr_earliest(const mshr_file_t* f) {
+    int best = 0;
+    for (int i = 1; i < f->size; i++) {
+        if (f->ready[i] < f->ready[best]) best = i;
+    }
+    return best;
+}
+
+timing_t* timing_create(hierarchy_t* h, const char* spec) {
+    char* end;
+    long mshrs = strtol(spec, &end, 10);
+    long window = DEFAULT_WINDOW;
+    if (end == spec || mshrs < 1) return NULL;
+    if (*end == ':') {
+        const char* p = end + 1;
+        window = strtol(p, &end, 10);
+        if (end == p) return NULL;
+    }
+    if (*end || window < 1) return NULL;
+
+    timing_t* t = (timing_t*)calloc(1, sizeof(timing_t));
+    t->hierarchy = h;
+    t->window = (int)window;
+    t->retired = (counter_t*)calloc(window, sizeof(counter_t));
+    mshr_init(&t->mshrs[HIER_L1I], (int)mshrs);
+    mshr_init(&t->mshrs[HIER_L1D], (int)mshrs);
+    return t;
+}
+
+void timing_access(timing_t* t, addr_t physical_addr, int access_type) {
+    hierarchy_t* h = t->hierarchy;
+    int k = access_type == IFETCH ? HIER_L1I : HIER_L1D;
+    const hier_level_t* l1 = &h->levels[k];
+    mshr_file_t* f = &t->mshrs[k];
+    addr_t line = physical_addr / l1->cache->block_size;
+
+    counter_t issue = t->count ? t->issue + 1 : 0;
+    counter_t* slot = &t->retired[t->count % t->window];
+    if (t->count >= (counter_t)t->window && *slot > issue) {
+        t->window_stalls += *slot - issue;
+        issue = *slot;
+    }
+
+    // Look for an outstanding fetch of the block before the hierarchy fills it
+    int merged = mshr_find(f, line, issue);
+    int latency = hierarchy_access(h, physical_addr, access_type);
+    counter_t done;
+    if (merged >= 0) {
+        t->merges++;
+        done = issue + l1->latency;
+        if (f->ready[merged] > done) done = f->ready[merged];
+    } else if (latency > l1->latency) {
+        int m = mshr_earliest(f);
+        if (f->ready[m] > issue) {
+            t->mshr_stalls += f->ready[m] - issue;
+            issue = f->ready[m];
+        }
+        mshr_sweep(f, issue);
+        f->lines[m] = line;
+        f->ready[m] = issue + latency;
+        done = issue + latency;
+    } else {
+        done = issue + latency;
+    }
+    if (merged >= 0 || latency > l1->latency) {
+        t->misses++;
+        t->miss_cycles += done - issue;
+    }
+
+    if (done < t->last_retired) done = t->last_retired;
+    *slot = done;
+    t->last_retired = done;
+    t->issue = issue;
+    t->count++;
+}
+
+void timing_print_stats(timing_t* t, FILE* out) {
+    counter_t cycles = t->last_retired;
+    fprintf(out, "cycles, accesses_per_cycle, misses, avg_miss_latency, mshr_merges,"
+                 " mshr_stall_cycles, window_stall_cycles\n");
+    fprintf(out, "%llu, %.3f, %llu, %.3f, %llu, %llu, %llu\n", cycles,
+            cycles ? (double)t->count / cycles : 0.0, t->misses,
+            t->misses ? (double)t->miss_cycles / t->misses : 0.0,
+            t->merges, t->mshr_stalls, t->window_stalls);
+
+    fprintf(out, "mshr_file, busy_mshrs, cycles\n");
+    for (int k = HIER_L1I; k <= HIER_L1D; k++) {
+        mshr_file_t* f = &t->mshrs[k];
+        mshr_sweep(f, cycles);
+        for (int i = 0; i <= f->size; i++) {
+            fprintf(out, "%s, %d, %llu\n", file_names[k], i, f->histogram[i]);
+        }
+    }
+}
+
+void timing_free(timing_t* t) {
+    if (!t) return;
+    mshr_cleanup(&t->mshrs[HIER_L1I]);
+    mshr_cleanup(&t->mshrs[HIER_L1D]);
+    free(t->retired);
+    free(t);
+}
@@ -0,0 +1,77 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __TIMING_H
+#define __TIMING_H
+
+#include <stdio.h>
+#include "hierarchy.h"
+
+/**
+ * Timing estimates for a hierarchy. The hierarchy decides hits and misses as usual;
+ * the timing model decides when each access issues and completes.
+ *
+ * Accesses issue in trace order, at most one per cycle. An access takes the latency
+ * hierarchy_access reports for it. It retires once it and every earlier access have
+ * completed. At most <window> accesses are in flight: an access cannot issue until
+ * the one <window> places before it has retired.
+ *
+ * Each L1 has a file of <mshrs> miss status holding registers. A miss must allocate
+ * an MSHR, which it holds until the block arrives, and issue stalls while they are
+ * all busy. A later access to a block that is still on its way is a secondary miss.
+ * It merges into the block's MSHR and completes when the block arrives.
+ */
+
+typedef struct mshr_file_t {
+	int size;				// Number of MSHRs
+	addr_t* lines;			// Line address each MSHR is fetching
+	counter_t* ready;		// Cycle each MSHR's block arrives; free from then on
+	counter_t* histogram;	// histogram[k] is the number of cycles with k MSHRs busy
+	counter_t* pending;		// Scratch space for mshr_sweep, one entry per MSHR
+	counter_t swept;		// The histogram covers the cycles before this one
+} mshr_file_t;
+
+typedef struct timing_t {
+	hierarchy_t* hierarchy;
+	mshr_file_t mshrs[HIER_L1D + 1];	// One file per L1, indexed by HIER_L1I/HIER_L1D
+	int window;						// Maximum accesses in flight
+	counter_t* retired;				// Retire cycle of the last <window> accesses
+	counter_t count;				// Accesses so far
+	counter_t issue;				// Issue cycle of the last access
+	counter_t last_retired;			// Retire cycle of the last access
+	counter_t misses;				// Primary and secondary misses
+	counter_t miss_cycles;			// Total issue-to-completion cycles of misses
+	counter_t merges;				// Secondary misses merged into an MSHR
+	counter_t mshr_stalls;			// Issue cycles lost waiting for a free MSHR
+	counter_t window_stalls;		// Issue cycles lost waiting for the window
+} timing_t;
+
+/**
+ * Function to create a timing model for <h> from <spec>, "<mshrs>[:<window>]". The
+ * window defaults to 128 accesses.
+ *
+ * @return the dynamically allocated model, or NULL if <spec> is invalid.
+ */
+timing_t* timing_create(hierarchy_t* h, const char* spec);
+
+/**
+ * Function to perform a SINGLE memory access to the hierarchy and time it.
+ *
+ * @param physical_addr is the address to use for the memory access.
+ * @param access_type is the type of access (MEMREAD, MEMWRITE or IFETCH).
+ */
+void timing_access(timing_t* t, addr_t physical_addr, int access_type);
+
+/**
+ * Function to print the estimated cycles, the average miss latency, the stall
+ * counts and the MSHR occupancy histogram of each L1, as CSV.
+ */
+void timing_print_stats(timing_t* t, FILE* out);
+
+/**
+ * Function to free <t>. The hierarchy is left alone.
+ */
+void timing_free(timing_t* t);
+
+#endif
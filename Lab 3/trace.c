@@ -0,0 +1,602 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <zlib.h>
+#include "trace.h"
+
+#define RING_SLOTS 16				// Batches the decoder may run ahead of the reader
+#define TEXT_BUFFER_SIZE (1 << 20)	// Decompressed bytes the decoder parses at a time
+
+static const unsigned char zstd_magic[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+/*
+ * A streamed trace. The decoder thread fills the slots of a ring of batches and the
+ * reader empties them, each side owning the slots between its index and the other's.
+ * head is only written by the decoder and tail only by the reader, so the ring needs no
+ * lock: each index is published with a release store and read with an acquire load.
+ */
+typedef struct trace_stream_t {
+    gzFile in;					// Decompresses gzip and passes anything else through
+    pid_t decompressor;			// zstd -dc child feeding <in>, 0 if none
+    pthread_t thread;
+    trace_record_t* slots;		// RING_SLOTS batches of TRACE_BATCH_SIZE records
+    size_t lens[RING_SLOTS];	// Records in each published batch
+    size_t head;				// Batches published by the decoder
+    size_t tail;				// Batches released by the reader
+    int done;					// Set by the decoder once it has published everything
+    int stop;					// Set by the reader to make the decoder give up
+    int held;					// Reader only: whether it is handing out slot <tail>
+    size_t pos;					// Reader only: next record of the held slot
+    char* text;					// Decoder only: TEXT_BUFFER_SIZE + 1 bytes of input
+    size_t start, end;			// Decoder only: unparsed bytes of <text>
+    int eof;					// Decoder only: 1 once <in> is exhausted, -1 if it failed
+    char* name;					// File name for error messages
+    char error[256];			// Why decoding ended early, empty if it did not
+    int ended;					// Reader only: whether it has seen the end of the stream
+} trace_stream_t;
+
+/**
+ * Tries to map <filename> as a binary trace.
+ *
+ * @return 1 if the file is a binary trace and was mapped into <trace>, 0 if
+ *      it is not a binary trace, -1 on error.
+ */
+static int trace_map_binary(trace_t* trace, const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    trace_header_t header;
+    if ((size_t)st.st_size < sizeof(header)
+        || read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)
+        || memcmp(header.magic, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    size_t len = (size_t)st.st_size;
+    if (header.count > (len - sizeof(header)) / sizeof(trace_record_t)) {
+        fprintf(stderr, "%s: truncated binary trace\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    trace->binary = 1;
+    trace->map = map;
+    trace->map_len = len;
+    trace->records = (const trace_record_t*)((const char*)map + sizeof(header));
+    trace->count = header.count;
+    trace->pos = 0;
+    return 1;
+}
+
+/**
+ * Function to wait a little longer each time <*spins> goes up: spin first, then yield,
+ * then sleep, so a stalled side of the ring does not burn a core.
+ */
+static void backoff(int* spins) {
+    if (++*spins < 64) return;
+    if (*spins < 128) {
+        sched_yield();
+        return;
+    }
+    struct timespec ts = { 0, 50000 };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Function to record why decoding ended early. The first error is kept.
+ */
+static void stream_error(trace_stream_t* s, const char* what) {
+    if (!s->error[0]) snprintf(s->error, sizeof(s->error), "%s: %s", s->name, what);
+}
+
+/**
+ * Function to read up to <len> more decompressed bytes into <buf>, recording any
+ * decompression error.
+ *
+ * @return the number of bytes read, 0 at the end of the input or on error
+ */
+static size_t stream_read(trace_stream_t* s, void* buf, size_t len) {
+    int got = gzread(s->in, buf, (unsigned int)len);
+    if (got > 0) return (size_t)got;
+    int err;
+    const char* msg = gzerror(s->in, &err);
+    if (got < 0 || (err != Z_OK && err != Z_STREAM_END)) {
+        // zlib prefixes the message with "<fd:N>: "; the file name replaces that
+        const char* colon = strstr(msg, ": ");
+        if (strncmp(msg, "<fd:", 4) == 0 && colon) msg = colon + 2;
+        stream_error(s, err == Z_ERRNO ? strerror(errno) : msg);
+        s->eof = -1;
+    } else {
+        s->eof = 1;
+    }
+    return 0;
+}
+
+/**
+ * Function to move the unparsed input to the front of the text buffer and read more
+ * after it.
+ *
+ * @return the number of unparsed bytes
+ */
+static size_t stream_fill(trace_stream_t* s) {
+    size_t left = s->end - s->start;
+    memmove(s->text, s->text + s->start, left);
+    s->start = 0;
+    s->end = left;
+    while (!s->eof && s->end < TEXT_BUFFER_SIZE) {
+        s->end += stream_read(s, s->text + s->end, TEXT_BUFFER_SIZE - s->end);
+    }
+    s->text[s->end] = '\0';
+    return s->end;
+}
+
+/**
+ * Function to wait for a free slot in the ring.
+ *
+ * @return the free slot, or NULL if the reader has stopped the stream
+ */
+static trace_record_t* stream_claim(trace_stream_t* s) {
+    int spins = 0;
+    while (s->head - __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE) == RING_SLOTS) {
+        if (__atomic_load_n(&s->stop, __ATOMIC_RELAXED)) return NULL;
+        backoff(&spins);
+    }
+    return s->slots + (s->head % RING_SLOTS) * TRACE_BATCH_SIZE;
+}
+
+static void stream_publish(trace_stream_t* s, size_t n) {
+    s->lens[s->head % RING_SLOTS] = n;
+    __atomic_store_n(&s->head, s->head + 1, __ATOMIC_RELEASE);
+}
+
+static inline int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * Parses the fields of a text trace line, "<type> <address> <instruction address>" in
+ * decimal and hex, into <r>.
+ *
+ * @return 1 on success, 0 if the line is blank, -1 if it is malformed
+ */
+static int parse_line(const char* p, const char* end, trace_record_t* r) {
+    unsigned long long fields[3] = { 0, 0, 0 };
+    int negative = 0;
+    while (p < end && is_space(*p)) p++;
+    if (p == end) return 0;
+    for (int f = 0; f < 3; f++) {
+        while (p < end && is_space(*p)) p++;
+        const char* digits = p;
+        if (f == 0) {
+            if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+            digits = p;
+            while (p < end && *p >= '0' && *p <= '9') fields[0] = fields[0] * 10 + (*p++ - '0');
+        } else {
+            if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) digits = p += 2;
+            for (; p < end; p++) {
+                unsigned int d;
+                if (*p >= '0' && *p <= '9') {
+                    d = *p - '0';
+                } else if ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'f') {
+                    d = (*p | 0x20) - 'a' + 10;
+                } else {
+                    break;
+                }
+                fields[f] = (fields[f] << 4) | d;
+            }
+        }
+        // Anything after the last field, such as a core column, is ignored
+        if (p == digits || (f < 2 && p < end && !is_space(*p))) return -1;
+    }
+    int type = negative ? -(int)fields[0] : (int)fields[0];
+    *r = trace_record_make(type, fields[1], fields[2]);
+    return 1;
+}
+
+/**
+ * Function to decode a binary trace of <count> records from the stream. Its header
+ * has already been consumed from the text buffer.
+ */
+static void decode_binary(trace_stream_t* s, uint64_t count) {
+    trace_record_t* slot;
+    while (count > 0 && (slot = stream_claim(s)) != NULL) {
+        size_t want = count < TRACE_BATCH_SIZE ? count : TRACE_BATCH_SIZE;
+        size_t bytes = want * sizeof(trace_record_t);
+        size_t got = 0;
+        // Whatever is left in the text buffer comes first
+        size_t buffered = s->end - s->start;
+        if (buffered > 0) {
+            got = buffered < bytes ? buffered : bytes;
+            memcpy(slot, s->text + s->start, got);
+            s->start += got;
+        }
+        while (got < bytes && !s->eof) {
+            got += stream_read(s, (char*)slot + got, bytes - got);
+        }
+        size_t records = got / sizeof(trace_record_t);
+        if (records > 0) stream_publish(s, records);
+        if (records < want) {
+            stream_error(s, "truncated binary trace");
+            return;
+        }
+        count -= records;
+    }
+}
+
+/**
+ * Function to decode a text trace from the stream. It skips blank lines and ends the
+ * trace with an error at the first malformed line.
+ */
+static void decode_text(trace_stream_t* s) {
+    trace_record_t* slot = NULL;
+    size_t n = 0;
+    unsigned long long line_no = 0;
+    for (;;) {
+        char* line = s->text + s->start;
+        char* newline = memchr(line, '\n', s->end - s->start);
+        if (!newline && !s->eof && s->start > 0) {
+            stream_fill(s);
+            continue;
+        }
+        if (!newline && s->start == s->end) break;
+        // A line longer than the whole buffer is malformed anyway
+        char* line_end = newline ? newline : s->text + s->end;
+        s->start = newline ? (size_t)(newline + 1 - s->text) : s->end;
+        line_no++;
+
+        trace_record_t r;
+        int parsed = parse_line(line, line_end, &r);
+        if (parsed < 0) {
+            char what[64];
+            snprintf(what, sizeof(what), "malformed line %llu", line_no);
+            stream_error(s, what);
+            break;
+        }
+        if (parsed == 0) continue;
+        if (!slot && (slot = stream_claim(s)) == NULL) return;
+        slot[n++] = r;
+        if (n == TRACE_BATCH_SIZE) {
+            stream_publish(s, n);
+            slot = NULL;
+            n = 0;
+        }
+    }
+    if (n > 0) stream_publish(s, n);
+}
+
+static void* stream_decode(void* arg) {
+    trace_stream_t* s = (trace_stream_t*)arg;
+    stream_fill(s);
+    trace_header_t header;
+    if (s->end >= sizeof(header) && memcmp(s->text, TRACE_MAGIC, TRACE_MAGIC_LEN) == 0) {
+        memcpy(&header, s->text, sizeof(header));
+        s->start = sizeof(header);
+        decode_binary(s, header.count);
+    } else {
+        decode_text(s);
+    }
+
+    // zstd failing looks like the input ending, so its exit status has the last word.
+    // Once its output has ended it has exited or is about to; otherwise it may still be
+    // writing, and trace_close() stops it.
+    int status;
+    if (s->decompressor > 0 && s->eof == 1 && waitpid(s->decompressor, &status, 0) > 0) {
+        s->decompressor = 0;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            s->error[0] = '\0';
+            stream_error(s, "zstd -dc failed");
+        }
+    }
+    __atomic_store_n(&s->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * Function to start a zstd -dc process decompressing <fd>.
+ *
+ * @return the read end of a pipe carrying its output, or -1 on error
+ */
+static int start_decompressor(trace_stream_t* s, int fd) {
+    int out[2];
+    if (pipe(out) < 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(out[0]);
+        close(out[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(fd, STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        close(fd);
+        close(out[0]);
+        close(out[1]);
+        execlp("zstd", "zstd", "-dcq", (char*)NULL);
+        perror("Unable to run zstd");
+        _exit(127);
+    }
+    close(fd);
+    close(out[1]);
+    s->decompressor = pid;
+    return out[0];
+}
+
+/**
+ * Opens <filename>, or standard input for "-", as a streamed trace and starts its
+ * decoder thread.
+ *
+ * @return 0 on success, -1 on error
+ */
+static int trace_open_stream(trace_t* trace, const char* filename) {
+    trace_stream_t* s = (trace_stream_t*)calloc(1, sizeof(trace_stream_t));
+    if (!s) return -1;
+    trace->stream = s;
+    s->name = strdup(filename);
+    s->slots = (trace_record_t*)malloc(sizeof(trace_record_t) * TRACE_BATCH_SIZE * RING_SLOTS);
+    s->text = (char*)malloc(TEXT_BUFFER_SIZE + 1);
+    if (!s->name || !s->slots || !s->text) return -1;
+
+    int fd = strcmp(filename, "-") == 0 ? dup(STDIN_FILENO) : open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    // zlib passes data it does not recognize through untouched, so only zstd needs
+    // spotting here. Standard input cannot be peeked at, so it has to be plain or gzip.
+    unsigned char magic[sizeof(zstd_magic)];
+    if (strcmp(filename, "-") != 0 && pread(fd, magic, sizeof(magic), 0) == sizeof(magic)
+        && memcmp(magic, zstd_magic, sizeof(magic)) == 0
+        && (fd = start_decompressor(s, fd)) < 0) {
+        return -1;
+    }
+    s->in = gzdopen(fd, "rb");
+    if (!s->in) {
+        close(fd);
+        return -1;
+    }
+    gzbuffer(s->in, 1 << 17);
+
+    if (pthread_create(&s->thread, NULL, stream_decode, s) != 0) {
+        gzclose(s->in);
+        s->in = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Takes up to <max> records from the ring of streamed <trace>, waiting for the decoder
+ * if it is behind. The records stay valid until the next call.
+ *
+ * @param out is set to point at the first record taken
+ * @return the number of records taken, 0 at the end of the stream
+ */
+static size_t stream_take(trace_t* trace, size_t max, const trace_record_t** out) {
+    trace_stream_t* s = trace->stream;
+    if (s->held && s->pos == s->lens[s->tail % RING_SLOTS]) {
+        __atomic_store_n(&s->tail, s->tail + 1, __ATOMIC_RELEASE);
+        s->held = 0;
+    }
+    if (max == 0) return 0;
+    if (!s->held) {
+        int spins = 0;
+        while (__atomic_load_n(&s->head, __ATOMIC_ACQUIRE) == s->tail) {
+            // The decoder publishes its last batch before it sets done
+            if (__atomic_load_n(&s->done, __ATOMIC_ACQUIRE)
+                && __atomic_load_n(&s->head, __ATOMIC_ACQUIRE) == s->tail) {
+                s->ended = 1;
+                return 0;
+            }
+            backoff(&spins);
+        }
+        s->held = 1;
+        s->pos = 0;
+    }
+    size_t slot = s->tail % RING_SLOTS;
+    size_t n = s->lens[slot] - s->pos;
+    if (n > max) n = max;
+    *out = s->slots + slot * TRACE_BATCH_SIZE + s->pos;
+    s->pos += n;
+    return n;
+}
+
+/**
+ * Counts <n> handed out records against the limit of <trace>.
+ */
+static inline void consume(trace_t* trace, size_t n) {
+    if (trace->limit != SIZE_MAX) trace->limit -= n;
+}
+
+trace_t* trace_open(const char* filename) {
+    trace_t* trace = (trace_t*)calloc(1, sizeof(trace_t));
+    if (!trace) return NULL;
+    trace->limit = SIZE_MAX;
+
+    int mapped = strcmp(filename, "-") == 0 ? 0 : trace_map_binary(trace, filename);
+    if (mapped < 0) {
+        free(trace);
+        return NULL;
+    }
+    if (mapped) return trace;
+
+    if (trace_open_stream(trace, filename) < 0) {
+        trace_close(trace);
+        return NULL;
+    }
+    return trace;
+}
+
+size_t trace_next_batch(trace_t* trace, const trace_record_t** batch) {
+    if (trace->binary) {
+        size_t n = trace->count - trace->pos;
+        if (n > TRACE_BATCH_SIZE) n = TRACE_BATCH_SIZE;
+        if (n > trace->limit) n = trace->limit;
+        *batch = trace->records + trace->pos;
+        trace->pos += n;
+        consume(trace, n);
+        return n;
+    }
+
+    size_t n = stream_take(trace, trace->limit < TRACE_BATCH_SIZE ? trace->limit
+                                                                  : TRACE_BATCH_SIZE, batch);
+    consume(trace, n);
+    return n;
+}
+
+size_t trace_read(trace_t* trace, trace_record_t* buf, size_t max) {
+    if (max > trace->limit) max = trace->limit;
+    if (trace->binary) {
+        size_t n = trace->count - trace->pos;
+        if (n > max) n = max;
+        memcpy(buf, trace->records + trace->pos, sizeof(trace_record_t) * n);
+        trace->pos += n;
+        consume(trace, n);
+        return n;
+    }
+
+    size_t n = 0;
+    size_t got;
+    const trace_record_t* records;
+    while (n < max && (got = stream_take(trace, max - n, &records)) > 0) {
+        memcpy(buf + n, records, sizeof(trace_record_t) * got);
+        n += got;
+    }
+    consume(trace, n);
+    return n;
+}
+
+const trace_record_t* trace_load(trace_t* trace, size_t* count) {
+    if (trace->binary) {
+        *count = trace->count - trace->pos;
+        if (*count > trace->limit) *count = trace->limit;
+        const trace_record_t* records = trace->records + trace->pos;
+        trace->pos += *count;
+        consume(trace, *count);
+        return records;
+    }
+
+    size_t len = 0;
+    size_t cap = TRACE_BATCH_SIZE;
+    trace_record_t* records = (trace_record_t*)malloc(sizeof(trace_record_t) * cap);
+    size_t n;
+    while (records && (n = trace_read(trace, records + len, cap - len)) > 0) {
+        len += n;
+        if (len == cap) {
+            cap *= 2;
+            trace_record_t* grown = (trace_record_t*)realloc(records, sizeof(trace_record_t) * cap);
+            if (!grown) free(records);
+            records = grown;
+        }
+    }
+    free(trace->loaded);
+    trace->loaded = records;
+    *count = records ? len : 0;
+    return records;
+}
+
+size_t trace_skip(trace_t* trace, size_t n) {
+    if (trace->binary) {
+        if (n > trace->count - trace->pos) n = trace->count - trace->pos;
+        trace->pos += n;
+        return n;
+    }
+
+    size_t skipped = 0;
+    size_t got;
+    const trace_record_t* records;
+    while (skipped < n && (got = stream_take(trace, n - skipped, &records)) > 0) {
+        skipped += got;
+    }
+    return skipped;
+}
+
+void trace_set_limit(trace_t* trace, size_t n) {
+    trace->limit = n;
+}
+
+const char* trace_error(const trace_t* trace) {
+    const trace_stream_t* s = trace->stream;
+    return s && s->ended && s->error[0] ? s->error : NULL;
+}
+
+void trace_close(trace_t* trace) {
+    if (!trace) return;
+    if (trace->map) munmap(trace->map, trace->map_len);
+    trace_stream_t* s = trace->stream;
+    if (s) {
+        if (s->in) {
+            __atomic_store_n(&s->stop, 1, __ATOMIC_RELAXED);
+            pthread_join(s->thread, NULL);
+            gzclose(s->in);
+        }
+        if (s->decompressor > 0) {
+            // zstd is still running if the trace was not read to the end
+            kill(s->decompressor, SIGTERM);
+            waitpid(s->decompressor, NULL, 0);
+        }
+        free(s->name);
+        free(s->slots);
+        free(s->text);
+        free(s);
+    }
+    free(trace->loaded);
+    free(trace);
+}
+
+long long trace_convert(const char* in_name, const char* out_name) {
+    trace_t* in = trace_open(in_name);
+    if (!in) return -1;
+
+    FILE* out = fopen(out_name, "wb");
+    if (!out) {
+        trace_close(in);
+        return -1;
+    }
+
+    // Write a placeholder header and patch the count in once we know it
+    trace_header_t header;
+    memcpy(header.magic, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    header.count = 0;
+    int ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    const trace_record_t* batch;
+    size_t n;
+    while (ok && (n = trace_next_batch(in, &batch)) > 0) {
+        ok = fwrite(batch, sizeof(trace_record_t), n, out) == n;
+        header.count += n;
+    }
+    if (ok && trace_error(in)) {
+        fprintf(stderr, "%s\n", trace_error(in));
+        errno = EIO;
+        ok = 0;
+    }
+
+    ok = ok && fseek(out, 0, SEEK_SET) == 0
+            && fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = (fclose(out) == 0) && ok;
+    trace_close(in);
+    return ok ? (long long)header.count : -1;
+}
@@ -0,0 +1,161 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Trace reader for cachesim. Two on-disk formats are understood:
+ *
+ *  - text:   one "<type> <address> <instr>" line per access, with the address
+ *            and instruction in hex. This is the format the lab traces use.
+ *  - binary: a 16-byte header (TRACE_MAGIC followed by the record count)
+ *            and then fixed-size trace_record_t entries in host byte order.
+ *
+ * The format is detected from the first bytes of the file. Binary trace files are
+ * mmap'd and handed out in place, so reading them costs no parsing at all.
+ * Everything else is streamed: text traces, gzip- or zstd-compressed traces of
+ * either format, and standard input (named "-"), which may be plain or gzip. A
+ * decoder thread decompresses and parses the stream into a ring of batches ahead of
+ * the reader, so decoding overlaps with simulation. gzip is decompressed with zlib
+ * (link with -lz); zstd by a "zstd -dc" child process. Either way the caller sees
+ * batches of records via trace_next_batch().
+ *
+ * A region of a trace can be selected by skipping records with trace_skip() and
+ * capping how many more are handed out with trace_set_limit().
+ */
+
+#define TRACE_MAGIC "CSIMTRC1"
+#define TRACE_MAGIC_LEN 8
+#define TRACE_BATCH_SIZE 4096
+
+// The access type lives in the top byte of a record's meta word, the
+// instruction address in the remaining 56 bits.
+#define TRACE_TYPE_SHIFT 56
+#define TRACE_INSTR_MASK ((1ULL << TRACE_TYPE_SHIFT) - 1)
+
+/**
+ * One trace record. This is also the on-disk layout of the binary format.
+ */
+typedef struct trace_record_t {
+	uint64_t addr;		// Physical address of the access
+	uint64_t meta;		// Access type and instruction address, see above
+} trace_record_t;
+
+/**
+ * Header at the start of a binary trace.
+ */
+typedef struct trace_header_t {
+	char magic[TRACE_MAGIC_LEN];
+	uint64_t count;		// Number of records following the header
+} trace_header_t;
+
+struct trace_stream_t;
+
+typedef struct trace_t {
+	int binary;					// 1 if this is an mmap'd binary trace
+	struct trace_stream_t* stream;	// Streamed traces only: the decoder thread and its ring
+	void* map;					// Binary traces only: the whole mapping
+	size_t map_len;
+	const trace_record_t* records;	// Binary traces only: first record
+	size_t count;				// Binary traces only: number of records
+	size_t pos;					// Binary traces only: next record to hand out
+	trace_record_t* loaded;		// Streamed traces only: records decoded by trace_load()
+	size_t limit;				// Records still to be handed out, SIZE_MAX if unlimited
+} trace_t;
+
+static inline int trace_record_type(const trace_record_t* r) {
+	return (int)(r->meta >> TRACE_TYPE_SHIFT);
+}
+
+static inline uint64_t trace_record_instr(const trace_record_t* r) {
+	return r->meta & TRACE_INSTR_MASK;
+}
+
+static inline trace_record_t trace_record_make(int type, uint64_t addr, uint64_t instr) {
+	trace_record_t r;
+	r.addr = addr;
+	r.meta = ((uint64_t)type << TRACE_TYPE_SHIFT) | (instr & TRACE_INSTR_MASK);
+	return r;
+}
+
+/**
+ * Opens a trace in either format, compressed or not.
+ *
+ * @param filename is the path of the trace, or "-" for standard input
+ * @return the trace handle, or NULL if it could not be opened
+ */
+trace_t* trace_open(const char* filename);
+
+/**
+ * Gets the next batch of records from <trace>. The returned records stay valid
+ * until the next call on the same trace.
+ *
+ * @param trace is the trace to read from
+ * @param batch is set to point at the first record of the batch
+ * @return the number of records in the batch, 0 at the end of the trace
+ */
+size_t trace_next_batch(trace_t* trace, const trace_record_t** batch);
+
+/**
+ * Copies up to <max> of the next records of <trace> into <buf>.
+ *
+ * @param trace is the trace to read from
+ * @param buf is where the records are stored
+ * @param max is the capacity of <buf> in records
+ * @return the number of records read, 0 at the end of the trace
+ */
+size_t trace_read(trace_t* trace, trace_record_t* buf, size_t max);
+
+/**
+ * Decodes the rest of <trace> into memory in one go. Binary traces are already in
+ * memory and are returned in place.
+ *
+ * @param trace is the trace to read from
+ * @param count is set to the number of records
+ * @return the records, valid until trace_close(), or NULL if out of memory
+ */
+const trace_record_t* trace_load(trace_t* trace, size_t* count);
+
+/**
+ * Skips the next <n> records of <trace>. Binary trace files skip in place; streamed
+ * traces still have to decode the records. The limit does not apply to skipped records.
+ *
+ * @return the number of records skipped, less than <n> only at the end of the trace
+ */
+size_t trace_skip(trace_t* trace, size_t n);
+
+/**
+ * Makes <trace> hand out at most <n> more records, SIZE_MAX for no limit.
+ */
+void trace_set_limit(trace_t* trace, size_t n);
+
+/**
+ * Gets why a streamed trace ended early: a decompression error, a truncated binary
+ * trace or a failed zstd. Only set once the reader has reached the end of the trace,
+ * whose records are then a prefix of the real ones.
+ *
+ * @return the error, prefixed with the file name, or NULL if there was none
+ */
+const char* trace_error(const trace_t* trace);
+
+/**
+ * Closes <trace> and frees anything allocated for it.
+ */
+void trace_close(trace_t* trace);
+
+/**
+ * Converts a trace (in either format) into a binary trace.
+ *
+ * @param in_name is the path of the trace to convert
+ * @param out_name is the path of the binary trace to write
+ * @return the number of records written, or -1 on error
+ */
+long long trace_convert(const char* in_name, const char* out_name);
+
+#endif
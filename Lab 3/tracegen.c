@@ -0,0 +1,340 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+/**
+ * Synthetic trace generator. It writes reproducible workloads for cachesim, in the
+ * text format ("<type> <address> <instr>" lines, in hex) or, with -b, the binary
+ * format of trace.h. The same options and seed always give the same trace.
+ *
+ * Patterns:
+ *   seq      8-byte words in address order, wrapping around the footprint
+ *   stride   every <stride> bytes, wrapping around the footprint
+ *   uniform  uniformly random words of the footprint
+ *   zipf     lines of the footprint chosen with Zipf(<alpha>) popularity; the hot
+ *            lines are scattered rather than adjacent
+ *   chase    a pointer chase: one random cycle through every line of the footprint
+ *   mixed    instruction fetches from a code region, with loops and branches, each
+ *            followed by a load or store a third of the time, half to a sequential
+ *            stream and half Zipf-distributed
+ *
+ * Build: gcc -std=gnu99 -O2 tracegen.c -o tracegen -lm
+ * Usage: ./tracegen [-b] [-n accesses] [-f footprint] [-S stride] [-z alpha]
+ *                   [-w write fraction] [-s seed] <pattern> <output>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "cachesim.h"
+
+#define LINE_SIZE 64
+#define DATA_BASE 0x10000000ULL
+#define CODE_BASE 0x400000ULL
+#define CODE_SIZE (64 * 1024)	// Code region of the mixed pattern
+#define NUM_PCS 64				// Load/store PCs of the data-only patterns
+
+typedef struct gen_t {
+	unsigned long long state;	// splitmix64 state
+	unsigned long long footprint;	// Bytes of data touched
+	unsigned long long lines;	// Lines of data touched
+	unsigned long long stride;
+	double alpha;
+	double writes;				// Fraction of data accesses that are stores
+	double* zipf_cdf;			// zipf, mixed: cumulative popularity of each rank
+	unsigned int* zipf_lines;	// zipf, mixed: line of each rank
+	unsigned int* chase_next;	// chase: next line of each line
+	unsigned long long pos;		// Position in the pattern
+	unsigned long long pc;		// mixed: next instruction
+	unsigned long long loop_start;	// mixed: start of the current loop
+	unsigned long long stream;	// mixed: next word of the sequential stream
+} gen_t;
+
+typedef struct writer_t {
+	FILE* out;
+	int binary;
+	trace_record_t buf[TRACE_BATCH_SIZE];
+	size_t len;
+} writer_t;
+
+static unsigned long long next_random(gen_t* g) {
+    unsigned long long z = (g->state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @return a random number in [0, 1).
+ */
+static double next_unit(gen_t* g) {
+    return (next_random(g) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @return a random number in [0, n).
+ */
+static unsigned long long next_below(gen_t* g, unsigned long long n) {
+    return next_random(g) % n;
+}
+
+static int data_type(gen_t* g) {
+    return next_unit(g) < g->writes ? MEMWRITE : MEMREAD;
+}
+
+/**
+ * Function to set up the popularity of ranks for Zipf sampling, and scatter the ranks
+ * over the lines with a random permutation.
+ */
+static void zipf_init(gen_t* g) {
+    g->zipf_cdf = (double*)malloc(sizeof(double) * g->lines);
+    g->zipf_lines = (unsigned int*)malloc(sizeof(unsigned int) * g->lines);
+    double sum = 0;
+    for (unsigned long long i = 0; i < g->lines; i++) {
+        sum += 1.0 / pow((double)(i + 1), g->alpha);
+        g->zipf_cdf[i] = sum;
+        g->zipf_lines[i] = (unsigned int)i;
+    }
+    for (unsigned long long i = 0; i < g->lines; i++) {
+        g->zipf_cdf[i] /= sum;
+    }
+    for (unsigned long long i = g->lines - 1; i > 0; i--) {
+        unsigned long long j = next_below(g, i + 1);
+        unsigned int t = g->zipf_lines[i];
+        g->zipf_lines[i] = g->zipf_lines[j];
+        g->zipf_lines[j] = t;
+    }
+}
+
+/**
+ * @return the address of a random word of a Zipf-distributed line.
+ */
+static unsigned long long zipf_addr(gen_t* g) {
+    double u = next_unit(g);
+    unsigned long long lo = 0, hi = g->lines - 1;
+    while (lo < hi) {
+        unsigned long long mid = (lo + hi) / 2;
+        if (g->zipf_cdf[mid] < u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return DATA_BASE + (unsigned long long)g->zipf_lines[lo] * LINE_SIZE
+           + next_below(g, LINE_SIZE / 8) * 8;
+}
+
+/**
+ * Function to link every line into one random cycle (Sattolo's algorithm), so the
+ * chase visits all of them before repeating.
+ */
+static void chase_init(gen_t* g) {
+    unsigned int* order = (unsigned int*)malloc(sizeof(unsigned int) * g->lines);
+    for (unsigned long long i = 0; i < g->lines; i++) {
+        order[i] = (unsigned int)i;
+    }
+    for (unsigned long long i = g->lines - 1; i > 0; i--) {
+        unsigned long long j = next_below(g, i);
+        unsigned int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    g->chase_next = (unsigned int*)malloc(sizeof(unsigned int) * g->lines);
+    for (unsigned long long i = 0; i < g->lines; i++) {
+        g->chase_next[order[i]] = order[(i + 1) % g->lines];
+    }
+    free(order);
+}
+
+static void writer_flush(writer_t* w) {
+    if (w->binary) {
+        fwrite(w->buf, sizeof(trace_record_t), w->len, w->out);
+    } else {
+        for (size_t i = 0; i < w->len; i++) {
+            fprintf(w->out, "%d %llx %llx\n", trace_record_type(&w->buf[i]),
+                    (unsigned long long)w->buf[i].addr,
+                    (unsigned long long)trace_record_instr(&w->buf[i]));
+        }
+    }
+    w->len = 0;
+}
+
+static void emit(writer_t* w, int type, unsigned long long addr, unsigned long long instr) {
+    w->buf[w->len++] = trace_record_make(type, addr, instr);
+    if (w->len == TRACE_BATCH_SIZE) writer_flush(w);
+}
+
+/**
+ * Function to generate the next access of the mixed pattern: an instruction fetch,
+ * sometimes followed by the data access of that instruction.
+ *
+ * @return the number of records written
+ */
+static int mixed_next(gen_t* g, writer_t* w, long long left) {
+    unsigned long long pc = g->pc;
+    emit(w, IFETCH, pc, pc);
+
+    // Mostly straight-line code in loops of up to 1 KB, with an occasional far branch
+    g->pc += 4;
+    double u = next_unit(g);
+    if (u < 0.02) {
+        g->pc = g->loop_start;
+    } else if (u < 0.025 || g->pc >= CODE_BASE + CODE_SIZE) {
+        g->pc = CODE_BASE + next_below(g, CODE_SIZE / 4) * 4;
+        g->loop_start = g->pc;
+    } else if (g->pc - g->loop_start > 1024) {
+        g->loop_start = g->pc;
+    }
+
+    if (left < 2 || next_unit(g) >= 1.0 / 3) return 1;
+    unsigned long long addr;
+    if (next_unit(g) < 0.5) {
+        addr = DATA_BASE + g->stream;
+        g->stream = (g->stream + 8) % g->footprint;
+    } else {
+        addr = zipf_addr(g);
+    }
+    emit(w, data_type(g), addr, pc);
+    return 2;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-b] [-n accesses] [-f footprint] [-S stride] [-z alpha]"
+                    " [-w write fraction] [-s seed] <pattern> <output>\n"
+                    "  patterns: seq, stride, uniform, zipf, chase, mixed\n"
+                    "  -b  write a binary trace (default text); <output> - is stdout\n"
+                    "  -n  number of accesses (default 1000000)\n"
+                    "  -f  bytes of data touched (default 1048576)\n"
+                    "  -S  stride in bytes for the stride pattern (default 256)\n"
+                    "  -z  Zipf exponent for the zipf and mixed patterns (default 1.0)\n"
+                    "  -w  fraction of data accesses that are stores (default 0.25)\n"
+                    "  -s  random seed (default 1)\n", prog);
+}
+
+int main(int argc, char** argv) {
+    const char* prog = argv[0];
+    int binary = 0;
+    long long n = 1000000;
+    gen_t g;
+    memset(&g, 0, sizeof(g));
+    g.footprint = 1 << 20;
+    g.stride = 256;
+    g.alpha = 1.0;
+    g.writes = 0.25;
+    g.state = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "bn:f:S:z:w:s:h")) != -1) {
+        switch (opt) {
+        case 'b':
+            binary = 1;
+            break;
+        case 'n':
+            n = atoll(optarg);
+            break;
+        case 'f':
+            g.footprint = strtoull(optarg, NULL, 0);
+            break;
+        case 'S':
+            g.stride = strtoull(optarg, NULL, 0);
+            break;
+        case 'z':
+            g.alpha = atof(optarg);
+            break;
+        case 'w':
+            g.writes = atof(optarg);
+            break;
+        case 's':
+            g.state = strtoull(optarg, NULL, 0);
+            break;
+        default:
+            print_usage(prog);
+            return 1;
+        }
+    }
+    if (argc - optind != 2 || n < 0 || g.stride == 0 || g.alpha <= 0
+        || g.footprint < LINE_SIZE || g.footprint / LINE_SIZE > 0xffffffffULL) {
+        print_usage(prog);
+        return 1;
+    }
+    const char* pattern = argv[optind];
+    const char* out_name = argv[optind + 1];
+    g.footprint -= g.footprint % LINE_SIZE;
+    g.lines = g.footprint / LINE_SIZE;
+
+    enum { SEQ, STRIDE, UNIFORM, ZIPF, CHASE, MIXED } kind;
+    if (strcmp(pattern, "seq") == 0) {
+        kind = SEQ;
+    } else if (strcmp(pattern, "stride") == 0) {
+        kind = STRIDE;
+    } else if (strcmp(pattern, "uniform") == 0) {
+        kind = UNIFORM;
+    } else if (strcmp(pattern, "zipf") == 0) {
+        kind = ZIPF;
+    } else if (strcmp(pattern, "chase") == 0) {
+        kind = CHASE;
+    } else if (strcmp(pattern, "mixed") == 0) {
+        kind = MIXED;
+    } else {
+        fprintf(stderr, "Unknown pattern: %s\n", pattern);
+        return 1;
+    }
+    if (kind == ZIPF || kind == MIXED) zipf_init(&g);
+    if (kind == CHASE) chase_init(&g);
+    g.pc = g.loop_start = CODE_BASE;
+
+    writer_t* w = (writer_t*)calloc(1, sizeof(writer_t));
+    w->binary = binary;
+    w->out = strcmp(out_name, "-") == 0 ? stdout : fopen(out_name, binary ? "wb" : "w");
+    if (!w->out) {
+        perror("Unable to open output");
+        return 1;
+    }
+    if (binary) {
+        trace_header_t header;
+        memcpy(header.magic, TRACE_MAGIC, TRACE_MAGIC_LEN);
+        header.count = (uint64_t)n;
+        fwrite(&header, sizeof(header), 1, w->out);
+    }
+
+    for (long long i = 0; i < n; i++) {
+        unsigned long long pc = CODE_BASE + (i % NUM_PCS) * 4;
+        switch (kind) {
+        case SEQ:
+            emit(w, data_type(&g), DATA_BASE + (i * 8ULL) % g.footprint, pc);
+            break;
+        case STRIDE:
+            emit(w, data_type(&g), DATA_BASE + (i * g.stride) % g.footprint, pc);
+            break;
+        case UNIFORM:
+            emit(w, data_type(&g), DATA_BASE + next_below(&g, g.footprint / 8) * 8, pc);
+            break;
+        case ZIPF:
+            emit(w, data_type(&g), zipf_addr(&g), pc);
+            break;
+        case CHASE:
+            // Every load depends on the last, so they all come from the same PC
+            emit(w, MEMREAD, DATA_BASE + g.pos * LINE_SIZE, CODE_BASE);
+            g.pos = g.chase_next[g.pos];
+            break;
+        case MIXED:
+            i += mixed_next(&g, w, n - i) - 1;
+            break;
+        }
+    }
+    writer_flush(w);
+
+    int ok = !ferror(w->out);
+    if (w->out != stdout) ok = fclose(w->out) == 0 && ok;
+    free(g.zipf_cdf);
+    free(g.zipf_lines);
+    free(g.chase_next);
+    free(w);
+    if (!ok) {
+        perror("Unable to write trace");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "writepath.h"
+
+static const char* policy_names[] = { "wb-wa", "wb-nwa", "wt-wa", "wt-nwa" };
+
+/**
+ * Function to send the write <w> to the next level.
+ */
+static void emit_write(write_path_t* wp, const wbuf_entry_t* w) {
+    if (w->full) {
+        wp->block_writes++;
+        wp->bytes_written += wp->cache->block_size;
+    } else {
+        wp->partial_writes++;
+        wp->bytes_written += (counter_t)__builtin_popcountll(w->words) * wp->word_bytes;
+    }
+}
+
+static void wbuf_drain_oldest(write_path_t* wp) {
+    emit_write(wp, &wp->wbuf[wp->wbuf_head]);
+    wp->wbuf_head = (wp->wbuf_head + 1) % wp->wbuf_depth;
+    wp->wbuf_len--;
+}
+
+/**
+ * @return the write buffer slot holding <line>, or -1 if it is not buffered.
+ */
+static int wbuf_find(const write_path_t* wp, addr_t line) {
+    for (int i = 0; i < wp->wbuf_len; i++) {
+        int slot = (wp->wbuf_head + i) % wp->wbuf_depth;
+        if (wp->wbuf[slot].line == line) return slot;
+    }
+    return -1;
+}
+
+/**
+ * Function to queue a write for the next level, merging it with a buffered write to
+ * the same block if there is one.
+ */
+static void send_write(write_path_t* wp, const wbuf_entry_t* w) {
+    if (!wp->wbuf_depth) {
+        emit_write(wp, w);
+        return;
+    }
+    int slot = wbuf_find(wp, w->line);
+    if (slot >= 0) {
+        wp->wbuf[slot].full |= w->full;
+        wp->wbuf[slot].words |= w->words;
+        wp->coalesced++;
+        return;
+    }
+    if (wp->wbuf_len == wp->wbuf_depth) wbuf_drain_oldest(wp);
+    wp->wbuf[(wp->wbuf_head + wp->wbuf_len) % wp->wbuf_depth] = *w;
+    wp->wbuf_len++;
+}
+
+static void send_block(write_path_t* wp, addr_t line) {
+    wbuf_entry_t w = { line, 1, 0 };
+    wp->cache->writebacks++;
+    send_write(wp, &w);
+}
+
+static void send_word(write_path_t* wp, addr_t physical_addr) {
+    int block_size = wp->cache->block_size;
+    wbuf_entry_t w = { physical_addr / block_size, 0,
+                       1ULL << (physical_addr % block_size / wp->word_bytes) };
+    send_write(wp, &w);
+}
+
+/**
+ * Function to read block <line> from the next level. A buffered write to the block
+ * is sent ahead of the read so the read sees it.
+ */
+static void read_block(write_path_t* wp, addr_t line) {
+    int slot = wbuf_find(wp, line);
+    if (slot >= 0) {
+        // Send everything up to and including the entry, keeping the buffer in order
+        while (wp->wbuf_head != slot) wbuf_drain_oldest(wp);
+        wbuf_drain_oldest(wp);
+    }
+    wp->bytes_read += wp->cache->block_size;
+}
+
+/**
+ * Function to take block <line> out of the victim cache.
+ *
+ * @return -1 if it is not there, otherwise 1 if it was dirty and 0 if clean.
+ */
+static int victim_take(write_path_t* wp, addr_t line) {
+    for (int i = 0; i < wp->num_victims; i++) {
+        victim_entry_t* v = &wp->victims[i];
+        if (v->valid && v->line == line) {
+            v->valid = 0;
+            return v->dirty;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Function to put a block evicted from the cache into the victim cache, writing back
+ * the victim cache's own LRU block if it was dirty. Without a victim cache a dirty
+ * block is written back directly.
+ */
+static void victim_insert(write_path_t* wp, addr_t line, int dirty) {
+    if (!wp->num_victims) {
+        if (dirty) send_block(wp, line);
+        return;
+    }
+    victim_entry_t* slot = &wp->victims[0];
+    for (int i = 0; i < wp->num_victims; i++) {
+        victim_entry_t* v = &wp->victims[i];
+        if (!v->valid) {
+            slot = v;
+            break;
+        }
+        if (v->last_used < slot->last_used) slot = v;
+    }
+    if (slot->valid && slot->dirty) send_block(wp, slot->line);
+    slot->line = line;
+    slot->valid = 1;
+    slot->dirty = dirty;
+    slot->last_used = wp->now;
+}
+
+void write_path_access(write_path_t* wp, addr_t physical_addr, int access_type) {
+    cache_t* c = wp->cache;
+    addr_t line = physical_addr / c->block_size;
+    int is_write = access_type == MEMWRITE;
+
+    wp->now++;
+    c->accesses++;
+    if (cache_probe(c, physical_addr, wp->write_through ? MEMREAD : access_type)) {
+        c->hits++;
+        if (is_write && wp->write_through) send_word(wp, physical_addr);
+        return;
+    }
+    c->misses++;
+
+    // A block in the victim cache is swapped back in whatever the write policy
+    int dirty = victim_take(wp, line);
+    if (dirty >= 0) {
+        wp->victim_hits++;
+    } else if (is_write && !wp->write_allocate) {
+        send_word(wp, physical_addr);
+        return;
+    } else {
+        read_block(wp, line);
+        dirty = 0;
+    }
+
+    addr_t victim;
+    int evicted = cache_fill(c, physical_addr, dirty || (is_write && !wp->write_through),
+                             &victim);
+    if (evicted != EVICT_NONE) {
+        victim_insert(wp, victim / c->block_size, evicted == EVICT_DIRTY);
+    }
+    if (is_write && wp->write_through) send_word(wp, physical_addr);
+}
+
+void write_path_flush(write_path_t* wp) {
+    while (wp->wbuf_len) wbuf_drain_oldest(wp);
+}
+
+write_path_t* write_path_create(cache_t* c, const char* policy, int victims, int wbuf_depth) {
+    int p = 0;
+    while (p < 4 && strcmp(policy, policy_names[p]) != 0) p++;
+    if (p == 4 || victims < 0 || wbuf_depth < 0) return NULL;
+
+    write_path_t* wp = (write_path_t*)calloc(1, sizeof(write_path_t));
+    wp->cache = c;
+    wp->write_through = p >= 2;
+    wp->write_allocate = p % 2 == 0;
+    wp->word_bytes = c->block_size / 64 > WRITE_WORD_BYTES ? c->block_size / 64 : WRITE_WORD_BYTES;
+    if (wp->word_bytes > c->block_size) wp->word_bytes = c->block_size;
+    wp->num_victims = victims;
+    wp->victims = (victim_entry_t*)calloc(victims ? victims : 1, sizeof(victim_entry_t));
+    wp->wbuf_depth = wbuf_depth;
+    wp->wbuf = (wbuf_entry_t*)calloc(wbuf_depth ? wbuf_depth : 1, sizeof(wbuf_entry_t));
+    return wp;
+}
+
+void write_path_print_stats(const write_path_t* wp, FILE* out) {
+    fprintf(out, "victim_hits, coalesced_writes, block_writes, partial_writes,"
+                 " bytes_written, bytes_read\n");
+    fprintf(out, "%llu, %llu, %llu, %llu, %llu, %llu\n", wp->victim_hits, wp->coalesced,
+            wp->block_writes, wp->partial_writes, wp->bytes_written, wp->bytes_read);
+}
+
+void write_path_free(write_path_t* wp) {
+    if (!wp) return;
+    free(wp->victims);
+    free(wp->wbuf);
+    free(wp);
+}
@@ -0,0 +1,106 @@
+/**
+ * @author ECE 3058 TAs
+ */
+
+#ifndef __WRITEPATH_H
+#define __WRITEPATH_H
+
+#include <stdio.h>
+#include "cachesim.h"
+
+/**
+ * The path from a cache to the next level: its write policy, a coalescing write
+ * buffer and a small fully associative victim cache. A write_path_t wraps a cache_t;
+ * accesses go through write_path_access, which keeps the cache's own statistics as
+ * usual and also counts the traffic that reaches the next level.
+ *
+ * Write policies:
+ *  - wb-wa:  write-back, write-allocate (what cache_access does)
+ *  - wb-nwa: write-back, no-write-allocate
+ *  - wt-wa:  write-through, write-allocate
+ *  - wt-nwa: write-through, no-write-allocate
+ *
+ * Under write-through blocks are never dirty and every write goes to the next level.
+ * Under no-write-allocate a write miss goes to the next level without filling.
+ *
+ * The victim cache holds blocks evicted from the cache. A miss that finds its block
+ * there swaps it back in instead of reading it from the next level, and only blocks
+ * evicted from the victim cache are written back. The cache's writebacks counter
+ * counts dirty blocks leaving for the next level.
+ *
+ * The write buffer holds writes on their way to the next level, one entry per block,
+ * and merges writes to a block that is already buffered. When it is full the oldest
+ * entry is sent on. A read of a buffered block sends that entry on first. The trace
+ * has no access sizes, so each write covers WRITE_WORD_BYTES bytes (or 1/64th of the
+ * block, if that is more).
+ */
+
+#define WRITE_WORD_BYTES 8
+
+typedef struct victim_entry_t {
+	addr_t line;			// Line address (address / block size)
+	int valid;
+	int dirty;
+	counter_t last_used;	// For LRU replacement
+} victim_entry_t;
+
+typedef struct wbuf_entry_t {
+	addr_t line;				// Line address
+	int full;					// 1 if the whole block is written
+	unsigned long long words;	// Otherwise, the words written
+} wbuf_entry_t;
+
+typedef struct write_path_t {
+	cache_t* cache;				// The cache whose writes are modelled
+	int write_through;			// 1 for write-through, 0 for write-back
+	int write_allocate;			// 1 to fill on a write miss
+	int word_bytes;				// Bytes per write and per bit of wbuf_entry_t.words
+	victim_entry_t* victims;	// Victim cache entries
+	int num_victims;			// Victim cache size in blocks, 0 for none
+	wbuf_entry_t* wbuf;			// Write buffer, a ring of wbuf_depth entries
+	int wbuf_depth;				// Write buffer size in blocks, 0 for none
+	int wbuf_head;				// Oldest entry
+	int wbuf_len;				// Entries in use
+	counter_t now;				// Accesses so far
+	counter_t victim_hits;		// Misses satisfied by the victim cache
+	counter_t coalesced;		// Writes merged into a buffered write
+	counter_t block_writes;		// Whole blocks written to the next level
+	counter_t partial_writes;	// Partial blocks written to the next level
+	counter_t bytes_written;	// Bytes written to the next level
+	counter_t bytes_read;		// Bytes read from the next level
+} write_path_t;
+
+/**
+ * Function to create the write path of <c>.
+ *
+ * @param policy is the write policy name, e.g. "wt-nwa".
+ * @param victims is the victim cache size in blocks, 0 for none.
+ * @param wbuf_depth is the write buffer size in blocks, 0 for none.
+ * @return the dynamically allocated write path, or NULL if <policy> is unknown.
+ */
+write_path_t* write_path_create(cache_t* c, const char* policy, int victims, int wbuf_depth);
+
+/**
+ * Function to perform a SINGLE memory access through the write path.
+ *
+ * @param physical_addr is the address to use for the memory access.
+ * @param access_type is the type of access (MEMREAD, MEMWRITE or IFETCH).
+ */
+void write_path_access(write_path_t* wp, addr_t physical_addr, int access_type);
+
+/**
+ * Function to send everything left in the write buffer to the next level.
+ */
+void write_path_flush(write_path_t* wp);
+
+/**
+ * Function to print the next-level traffic as a CSV header and line.
+ */
+void write_path_print_stats(const write_path_t* wp, FILE* out);
+
+/**
+ * Function to free <wp>. The cache is left alone.
+ */
+void write_path_free(write_path_t* wp);
+
+#endif
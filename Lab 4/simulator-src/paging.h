@@ -73,3 +73,10 @@ uint8_t mem_access(vaddr_t address, char write, uint8_t data);
 
 pfn_t free_frame(void);
 void page_fault(vaddr_t address);
+
+/*
+ * Free-frame bitmap, kept in page_replacement.c. Call free_frames_update()
+ * whenever a frame's protected or mapped bit changes.
+ */
+void free_frames_init(void);
+void free_frames_update(pfn_t pfn);
@@ -4,27 +4,92 @@
 #include "swap.h"
 #include "util.h"
 
+/* Entries are carved out of slabs of this many and recycled through a free
+   list, instead of being allocated and freed one page at a time. */
+#define SWAP_SLAB_ENTRIES 64
+#define SWAP_MIN_CAPACITY 1024
+
 static uint64_t TOKEN = 1;
+static swap_info_t *free_entries = NULL;
 
 swap_info_t *create_entry(void)
 {
-    swap_info_t *new_info = calloc(1, sizeof(swap_info_t));
-    if (!new_info) {
-        panic("could not allocate swap entry");
+    if (!free_entries) {
+        swap_info_t *slab = calloc(SWAP_SLAB_ENTRIES, sizeof(swap_info_t));
+        if (!slab) {
+            panic("could not allocate swap entry");
+        }
+        for (size_t i = 0; i < SWAP_SLAB_ENTRIES; i++) {
+            slab[i].next = free_entries;
+            free_entries = &slab[i];
+        }
     }
+
+    /* The page data of a recycled entry is stale, but swap_write()
+       overwrites all of it */
+    swap_info_t *new_info = free_entries;
+    free_entries = new_info->next;
+    new_info->next = NULL;
     new_info->token = TOKEN++;
     return new_info;
 }
 
+static inline uint64_t swap_slot(const swap_queue_t *queue, uint64_t token)
+{
+    return ((token * 0x9e3779b97f4a7c15ULL) >> 32) & (queue->capacity - 1);
+}
+
+/* Inserts info into the table, which must have a free slot */
+static void swap_table_insert(swap_queue_t *queue, swap_info_t *info)
+{
+    uint64_t slot = swap_slot(queue, info->token);
+    while (queue->table[slot]) {
+        slot = (slot + 1) & (queue->capacity - 1);
+    }
+    queue->table[slot] = info;
+}
+
+/* Doubles the table, keeping it at most half full */
+static void swap_table_grow(swap_queue_t *queue)
+{
+    swap_info_t **old_table = queue->table;
+    uint64_t old_capacity = queue->capacity;
+
+    queue->capacity = old_capacity ? old_capacity * 2 : SWAP_MIN_CAPACITY;
+    queue->table = calloc(queue->capacity, sizeof(swap_info_t *));
+    if (!queue->table) {
+        panic("could not allocate swap table");
+    }
+    for (uint64_t i = 0; i < old_capacity; i++) {
+        if (old_table[i]) {
+            swap_table_insert(queue, old_table[i]);
+        }
+    }
+    free(old_table);
+}
+
+/* Returns the slot holding token, or capacity if there is none */
+static uint64_t swap_table_lookup(swap_queue_t *queue, uint64_t token)
+{
+    if (!queue->capacity) {
+        return queue->capacity;
+    }
+    uint64_t slot = swap_slot(queue, token);
+    while (queue->table[slot]) {
+        if (queue->table[slot]->token == token) {
+            return slot;
+        }
+        slot = (slot + 1) & (queue->capacity - 1);
+    }
+    return queue->capacity;
+}
+
 void swap_queue_enqueue(swap_queue_t *queue, swap_info_t* info)
 {
-    info->next = NULL;
-    if (queue->head == NULL) {
-        queue->head = queue->tail = info;
-    } else {
-        queue->tail->next = info;
-        queue->tail = info;
+    if ((queue->size + 1) * 2 > queue->capacity) {
+        swap_table_grow(queue);
     }
+    swap_table_insert(queue, info);
     queue->size++;
     if (queue->size > queue->size_max) {
         queue->size_max = queue->size;
@@ -34,38 +99,31 @@ void swap_queue_enqueue(swap_queue_t *queue, swap_info_t* info)
 
 void swap_queue_dequeue(swap_queue_t *queue, uint64_t token)
 {
-    swap_info_t *curr = queue->head;
-    swap_info_t *prev = NULL;
-
-    while (curr) {
-        if (curr->token == token) {
-            if (prev) {
-                prev->next = curr->next;
-            } else {
-                queue->head = curr->next;
-            }
-            if (curr == queue->tail) {
-                queue->tail = prev;
-            }
-            break;
+    uint64_t mask = queue->capacity - 1;
+    uint64_t hole = swap_table_lookup(queue, token);
+    if (hole == queue->capacity) {
+        return;
+    }
+    swap_info_t *curr = queue->table[hole];
+
+    /* Shift later entries of the same probe run back into the hole, so
+       lookups never stop early at an empty slot */
+    for (uint64_t slot = (hole + 1) & mask; queue->table[slot]; slot = (slot + 1) & mask) {
+        uint64_t home = swap_slot(queue, queue->table[slot]->token);
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            queue->table[hole] = queue->table[slot];
+            hole = slot;
         }
-        prev = curr;
-        curr = curr->next;
     }
+    queue->table[hole] = NULL;
     queue->size--;
-    curr->next = NULL;
-    free(curr);
+
+    curr->next = free_entries;
+    free_entries = curr;
 }
 
 swap_info_t *swap_queue_find(swap_queue_t *queue, uint64_t token)
 {
-    swap_info_t *curr = queue->head;
-
-    while (curr) {
-        if (curr->token == token) {
-            return curr;
-        }
-        curr = curr->next;
-    }
-    return NULL;
+    uint64_t slot = swap_table_lookup(queue, token);
+    return slot < queue->capacity ? queue->table[slot] : NULL;
 }
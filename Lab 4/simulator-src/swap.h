@@ -10,12 +10,17 @@ typedef struct swap_info {
     uint64_t token;
     uint8_t  page_data[PAGE_SIZE];
 
-    struct swap_info *next;
+    struct swap_info *next;     /* Next free entry while on the free list */
 } swap_info_t;
 
+/*
+ * The swap space. Entries are found by token in an open-addressed hash
+ * table, so reads, writes and frees take constant time however much has
+ * been swapped out.
+ */
 typedef struct _swap_queue_t {
-    swap_info_t *head;
-    swap_info_t *tail;
+    swap_info_t **table;        /* Entries by token, NULL for an empty slot */
+    uint64_t capacity;          /* Slots in table, a power of two */
     uint64_t size;
     uint64_t size_max;
 } swap_queue_t;
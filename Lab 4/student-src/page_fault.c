@@ -47,6 +47,7 @@ void page_fault(vaddr_t address) {
       frame_table[index].protected = 0;
       frame_table[index].process = current_process;
       frame_table[index].vpn = vpn;
+      free_frames_update(index);
 
     /* Initialize the page's memory. On a page fault, it is not enough
      * just to allocate a new frame. We must load in the old data from
@@ -7,6 +7,43 @@
 
 pfn_t select_victim_frame(void);
 
+/*
+ * Free-frame bitmap. Bit i of free_frame_bits is set when frame i is neither
+ * protected nor mapped, and bit w of free_word_bits is set when word w of
+ * free_frame_bits is non-zero. The lowest free frame is then found with two
+ * count-trailing-zeros instead of a walk over the whole frame table.
+ */
+#define FREE_WORDS ((NUM_FRAMES + 63) / 64)
+#define FREE_SUMMARY_WORDS ((FREE_WORDS + 63) / 64)
+
+static uint64_t free_frame_bits[FREE_WORDS];
+static uint64_t free_word_bits[FREE_SUMMARY_WORDS];
+
+void free_frames_init(void) {
+    memset(free_frame_bits, 0, sizeof(free_frame_bits));
+    memset(free_word_bits, 0, sizeof(free_word_bits));
+    for (size_t i = 0; i < NUM_FRAMES; i++) {
+        free_frames_update((pfn_t)i);
+    }
+}
+
+void free_frames_update(pfn_t pfn) {
+    size_t word = pfn / 64;
+    uint64_t bit = 1ULL << (pfn % 64);
+    if (frame_table[pfn].protected==0 && frame_table[pfn].mapped==0) {
+        free_frame_bits[word] |= bit;
+    } else {
+        free_frame_bits[word] &= ~bit;
+    }
+
+    uint64_t word_bit = 1ULL << (word % 64);
+    if (free_frame_bits[word]) {
+        free_word_bits[word / 64] |= word_bit;
+    } else {
+        free_word_bits[word / 64] &= ~word_bit;
+    }
+}
+
 
 /*  --------------------------------- PROBLEM 7 --------------------------------------
     Make a free frame for the system to use.
@@ -47,6 +84,7 @@ pfn_t free_frame(void) {
         }
         page_entry->valid = 0;
         frame_table[victim_pfn].mapped = 0;
+        free_frames_update(victim_pfn);
     }
 
 
@@ -57,11 +95,12 @@ pfn_t free_frame(void) {
 
 
 pfn_t select_victim_frame() {
-    /* See if there are any free frames first */
+    /* See if there are any free frames first, lowest frame number first */
     size_t num_entries = MEM_SIZE / PAGE_SIZE;
-    for (size_t i = 0; i < num_entries; i++) {
-        if (frame_table[i].protected==0 && frame_table[i].mapped==0) {
-            return i;
+    for (size_t i = 0; i < FREE_SUMMARY_WORDS; i++) {
+        if (free_word_bits[i]) {
+            size_t word = i * 64 + (size_t)__builtin_ctzll(free_word_bits[i]);
+            return (pfn_t)(word * 64 + (size_t)__builtin_ctzll(free_frame_bits[word]));
         }
     }
 
@@ -53,6 +53,9 @@ void system_init(void)
      */
     // First frame is protected
     frame_table[0].protected = 1;
+
+    // Every other frame starts out free
+    free_frames_init();
 }
 
 /*  --------------------------------- PROBLEM 3 --------------------------------------
@@ -95,6 +98,7 @@ void proc_init(pcb_t *proc)
 
     // Mark the fte protected
     frame_table[process_frame].protected = 1;
+    free_frames_update(process_frame);
 
 }
 
@@ -217,6 +221,7 @@ void proc_cleanup(pcb_t *proc)
         if (pte->valid==1)
         {
             frame_table[pte->pfn].mapped = 0;
+            free_frames_update(pte->pfn);
         }
 
         if (pte->swap==1)
@@ -230,4 +235,5 @@ void proc_cleanup(pcb_t *proc)
 
     /* Free the page table itself in the frame table */
     frame_table[proc->saved_ptbr].protected = 0;
+    free_frames_update(proc->saved_ptbr);
 }